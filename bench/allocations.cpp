@@ -0,0 +1,71 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "bench.hpp"
+#include "modint.hpp"
+#include "modintfactory.hpp"
+
+const unsigned int RUNS = 100;
+
+// Every allocation in the program, counted by the replaced operator new
+std::atomic<unsigned long> allocation_count(0);
+
+void *operator new(size_t size) {
+  ++allocation_count;
+
+  if (void *pointer = malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { free(pointer); }
+
+void operator delete(void *pointer, size_t) noexcept { free(pointer); }
+
+// The mean number of allocations made by one x^n into a reused result, after
+// a warm up call has grown the scratch arena
+double allocations_per_pow(const ModInt &x, const BigInt &n,
+                           bool constant_time) {
+  ModInt result = x;
+
+  auto pow = [&]() {
+    if (constant_time) {
+      ModInt::pow_constant_time(result, x, n);
+    } else {
+      ModInt::pow(result, x, n);
+    }
+  };
+
+  pow();
+
+  unsigned long start = allocation_count;
+
+  for (unsigned int run = 0; run < RUNS; ++run) {
+    pow();
+  }
+
+  return static_cast<double>(allocation_count - start) / RUNS;
+}
+
+void report(BigInt::bit_index_type bits) {
+  ModIntFactory factory(random_odd(bits));
+  ModInt x = factory.create_int(random_bits(bits - 1));
+  BigInt n = random_bits(bits);
+
+  cout << bits << " bits: " << allocations_per_pow(x, n, false)
+       << " allocations per pow, " << allocations_per_pow(x, n, true)
+       << " per constant-time pow" << endl;
+}
+
+int main() {
+  seed_generator(1);
+
+  for (BigInt::bit_index_type bits : {512, 1024, 2048, 4096}) {
+    report(bits);
+  }
+
+  return 0;
+}
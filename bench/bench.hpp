@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+
+#include "bigint.hpp"
+#include "randint.hpp"
+
+using std::cout;
+using std::endl;
+
+// Fixtures shared by the benchmarks. Each benchmark is a program of its own,
+// so everything here is inline.
+
+typedef std::chrono::steady_clock bench_clock;
+
+// Timings keep the fastest of this many batches, so that a noisy machine
+// doesn't decide a comparison
+const unsigned int BATCHES = 20;
+
+// The time from start until now in nanoseconds, divided between runs
+inline double nanoseconds_since(bench_clock::time_point start,
+                                unsigned long runs = 1) {
+  return std::chrono::duration<double, std::nano>(bench_clock::now() - start)
+             .count() /
+         runs;
+}
+
+// Time function in nanoseconds per call, taking the fastest of batches
+// batches of runs_per_batch calls
+template <typename Function>
+double time_fastest(Function function, unsigned int runs_per_batch,
+                    unsigned int batches = BATCHES) {
+  double fastest = 0;
+
+  for (unsigned int batch = 0; batch < batches; ++batch) {
+    bench_clock::time_point start = bench_clock::now();
+
+    for (unsigned int run = 0; run < runs_per_batch; ++run) {
+      function();
+    }
+
+    double elapsed = nanoseconds_since(start, runs_per_batch);
+
+    if (batch == 0 || elapsed < fastest) {
+      fastest = elapsed;
+    }
+  }
+
+  return fastest;
+}
+
+// A random value below 2^bits
+inline BigInt random_bits(BigInt::bit_index_type bits) {
+  BigInt range(1);
+  range <<= BigInt::Bits(bits);
+
+  return random_bigint(range);
+}
+
+// A random odd number of exactly bits bits
+inline BigInt random_odd(BigInt::bit_index_type bits) {
+  BigInt top(1);
+  top <<= BigInt::Bits(bits - 1);
+
+  BigInt value = random_bits(bits - 1) + top;
+
+  if (value.least_significant_limb_value() % 2 == 0) {
+    value += BigInt(1);
+  }
+
+  return value;
+}
+
+// A random odd modulus of exactly limbs limbs, for the limb kernels
+inline BigInt::limbs_type random_modulus(BigInt::limbs_size_type limbs) {
+  BigInt::limbs_type result(limbs);
+  random_bits(limbs * BigInt::LIMB_WIDTH).copy_limbs(result.begin(), limbs);
+
+  result.front() |= 1;
+  result.back() |= 1;
+
+  return result;
+}
+
+// A random value below mod, padded to as many limbs
+inline BigInt::limbs_type random_below(const BigInt::limbs_type &mod) {
+  BigInt mod_value;
+  mod_value.assign(mod.cbegin(), mod.cend());
+
+  BigInt::limbs_type result(mod.size());
+  random_bigint(mod_value).copy_limbs(result.begin(), mod.size());
+
+  return result;
+}
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "bench.hpp"
+#include "modint.hpp"
+#include "modintfactory.hpp"
+
+const unsigned int RUNS_PER_BATCH = 4;
+
+// An exponent of exactly bits bits, with every bit set or only the top one
+BigInt extreme_exponent(BigInt::bit_index_type bits, bool all_ones) {
+  BigInt top(1);
+  top <<= BigInt::Bits(bits - 1);
+
+  if (!all_ones) {
+    return top;
+  }
+
+  BigInt ones = top;
+  ones <<= BigInt::Bits(1);
+  ones -= BigInt(1);
+
+  return ones;
+}
+
+// Time one batch of x^n in nanoseconds per call
+double time_batch(const ModInt &x, const BigInt &n, bool constant_time) {
+  bench_clock::time_point start = bench_clock::now();
+
+  for (unsigned int run = 0; run < RUNS_PER_BATCH; ++run) {
+    ModInt result = constant_time ? x.pow_constant_time(n) : x.pow(n);
+  }
+
+  return nanoseconds_since(start, RUNS_PER_BATCH);
+}
+
+/*
+Time both exponentiations over exponents of the same length but very
+different bit patterns. The constant-time times should be flat, while the
+variable-time ones follow the number of set bits.
+*/
+void compare(BigInt::bit_index_type bits) {
+  ModIntFactory factory(random_odd(bits));
+  ModInt x = factory.create_int(random_bits(bits - 1));
+
+  const char *names[] = {"one bit ", "random  ", "all ones"};
+  BigInt exponents[] = {extreme_exponent(bits, false),
+                        random_bits(bits - 1) + extreme_exponent(bits, false),
+                        extreme_exponent(bits, true)};
+
+  cout << bits << "-bit modulus and exponent" << endl;
+  cout << "exponent\tvariable (ns)\tconstant (ns)" << endl;
+
+  // The fastest batch of each, with the batches interleaved so that noise
+  // from the rest of the machine doesn't show up as a timing difference
+  double fastest[3][2];
+
+  for (unsigned int batch = 0; batch < BATCHES; ++batch) {
+    for (size_t e = 0; e < 3; ++e) {
+      for (size_t constant_time = 0; constant_time < 2; ++constant_time) {
+        double elapsed = time_batch(x, exponents[e], constant_time);
+
+        fastest[e][constant_time] =
+            batch == 0 ? elapsed : std::min(fastest[e][constant_time], elapsed);
+      }
+    }
+  }
+
+  double variable_min = fastest[0][0], variable_max = fastest[0][0],
+         constant_min = fastest[0][1], constant_max = fastest[0][1];
+
+  for (size_t e = 0; e < 3; ++e) {
+    cout << names[e] << "\t" << fastest[e][0] << "\t\t" << fastest[e][1]
+         << endl;
+
+    variable_min = std::min(variable_min, fastest[e][0]);
+    variable_max = std::max(variable_max, fastest[e][0]);
+    constant_min = std::min(constant_min, fastest[e][1]);
+    constant_max = std::max(constant_max, fastest[e][1]);
+  }
+
+  double variable_random = fastest[1][0], constant_random = fastest[1][1];
+
+  cout << "spread\t\t" << 100 * (variable_max - variable_min) / variable_min
+       << "%\t\t" << 100 * (constant_max - constant_min) / constant_min << "%"
+       << endl;
+  cout << "constant-time overhead on a random exponent: "
+       << 100 * (constant_random - variable_random) / variable_random << "%"
+       << endl
+       << endl;
+}
+
+int main() {
+  seed_generator(1);
+
+  compare(512);
+  compare(1024);
+  compare(2048);
+
+  return EXIT_SUCCESS;
+}
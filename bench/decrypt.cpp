@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "bench.hpp"
+#include "modint.hpp"
+#include "modintfactory.hpp"
+#include "rsacrtkey.hpp"
+
+const unsigned int RUNS_PER_BATCH = 8;
+
+// Decryption as stage2 did it before keys were cached, setting up every
+// factory and converting i_q and q into Montgomery form for each ciphertext
+BigInt decrypt_per_record(const RsaCrtKey::parameters_type &parameters,
+                          const BigInt &c) {
+  const BigInt &p = std::get<0>(parameters), &q = std::get<1>(parameters),
+               &d_p = std::get<2>(parameters), &d_q = std::get<3>(parameters),
+               &i_q = std::get<4>(parameters);
+
+  ModIntFactory p_f(p), q_f(q), N_f(p * q);
+
+  ModInt m1_mod_p = (c % p_f).pow(d_p), m2_mod_q = (c % q_f).pow(d_q);
+
+  ModInt m_diff_mod_p = m1_mod_p;
+  m_diff_mod_p -= m2_mod_q % p_f;
+
+  ModInt h_mod_p = (i_q % p_f) * m_diff_mod_p;
+
+  ModInt m_mod_N = m2_mod_q % N_f;
+  m_mod_N += (h_mod_p % N_f) * (q % N_f);
+
+  return static_cast<BigInt>(m_mod_N);
+}
+
+/*
+Time decrypting ciphertexts under one key, setting the key up for every
+ciphertext and precomputing it once in an RsaCrtKey. The exponents are
+exponent_bits long, so short ones show the per-record work that full length
+ones hide behind the exponentiations.
+*/
+void compare(BigInt::bit_index_type bits,
+             BigInt::bit_index_type exponent_bits) {
+  BigInt p = random_odd(bits / 2), q = random_odd(bits / 2);
+
+  RsaCrtKey::parameters_type parameters(p, q, random_odd(exponent_bits),
+                                        random_odd(exponent_bits),
+                                        random_bigint(p));
+  RsaCrtKey key(parameters);
+
+  BigInt c = random_bigint(p * q);
+
+  if (decrypt_per_record(parameters, c) != key.decrypt(c, false, false)) {
+    cout << bits << " bits: the decryptions disagree" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  double fastest[2] = {1e300, 1e300};
+
+  for (unsigned int batch = 0; batch < BATCHES; ++batch) {
+    for (int cached = 0; cached < 2; ++cached) {
+      bench_clock::time_point start = bench_clock::now();
+
+      for (unsigned int run = 0; run < RUNS_PER_BATCH; ++run) {
+        BigInt m = cached ? key.decrypt(c, false, false)
+                          : decrypt_per_record(parameters, c);
+      }
+
+      fastest[cached] = std::min(fastest[cached],
+                                 nanoseconds_since(start, RUNS_PER_BATCH));
+    }
+  }
+
+  cout << bits << "-bit N, " << exponent_bits
+       << "-bit exponents: " << fastest[0] / 1000 << " us per record, "
+       << fastest[1] / 1000 << " us with the key cached" << endl;
+}
+
+int main() {
+  seed_generator();
+
+  for (BigInt::bit_index_type bits : {1024, 2048, 4096}) {
+    compare(bits, 17);
+    compare(bits, bits / 2);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+#include "bench.hpp"
+#include "fixedbigint.hpp"
+
+const unsigned int RUNS_PER_BATCH = 200;
+
+/*
+Compare FixedBigInt's Montgomery kernels against BigInt's fixed-length ones
+for a modulus of Bits bits, checking that they agree.
+*/
+template <BigInt::limbs_size_type Bits> void compare() {
+  typedef FixedBigInt<Bits> Fixed;
+  const BigInt::limbs_size_type n = Fixed::LIMBS;
+
+  BigInt::limbs_type mod = random_modulus(n);
+  BigInt::limbs_type lhs = random_below(mod), rhs = random_below(mod);
+  BigInt::limb_type mod_neg_inv = -BigInt::mod_inv(mod.front());
+
+  BigInt::limbs_type dynamic_result(n), fixed_result(n), t(n + 2), square_t;
+  square_t.reserve(2 * n + 1);
+
+  double dynamic_multiply = time_fastest(
+      [&]() {
+        BigInt::montgomery_multiply_fixed(dynamic_result.begin(), lhs.cbegin(),
+                                          rhs.cbegin(), mod.cbegin(), n,
+                                          mod_neg_inv, t.begin());
+      },
+      RUNS_PER_BATCH);
+  double fixed_multiply = time_fastest(
+      [&]() {
+        Fixed::montgomery_multiply(fixed_result.begin(), lhs.cbegin(),
+                                   rhs.cbegin(), mod.cbegin(), n, mod_neg_inv,
+                                   t.begin());
+      },
+      RUNS_PER_BATCH);
+  bool multiply_agrees = dynamic_result == fixed_result;
+
+  double dynamic_square = time_fastest(
+      [&]() {
+        BigInt::montgomery_square_fixed(dynamic_result.begin(), lhs.cbegin(),
+                                        mod.cbegin(), n, mod_neg_inv, square_t);
+      },
+      RUNS_PER_BATCH);
+  double fixed_square = time_fastest(
+      [&]() {
+        Fixed::montgomery_square(fixed_result.begin(), lhs.cbegin(),
+                                 mod.cbegin(), n, mod_neg_inv, square_t);
+      },
+      RUNS_PER_BATCH);
+  bool square_agrees = dynamic_result == fixed_result;
+
+  cout << Bits << "\t" << dynamic_multiply << "\t\t" << fixed_multiply
+       << "\t\t" << dynamic_square << "\t\t" << fixed_square << "\t\t"
+       << (multiply_agrees && square_agrees ? "yes" : "NO") << endl;
+}
+
+int main() {
+  seed_generator(1);
+
+  cout << "bits\tmultiply (ns)\tfixed (ns)\tsquare (ns)\tfixed (ns)\tagree"
+       << endl;
+
+  compare<512>();
+  compare<1024>();
+  compare<2048>();
+  compare<4096>();
+
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <cstdlib>
+#include <sstream>
+
+#include "bench.hpp"
+
+const unsigned int VALUES = 1000;
+const unsigned int ROUNDS = 100;
+
+int main() {
+  seed_generator(1);
+
+  std::ostringstream values_out;
+
+  for (unsigned int n = 0; n < VALUES; ++n) {
+    values_out << random_bits(2048) << '\n';
+  }
+
+  const string values = values_out.str();
+
+  std::vector<BigInt> parsed(VALUES);
+  bench_clock::duration parse_elapsed(0), format_elapsed(0);
+
+  for (unsigned int round = 0; round < ROUNDS; ++round) {
+    std::istringstream in(values);
+
+    bench_clock::time_point start = bench_clock::now();
+
+    for (BigInt &value : parsed) {
+      in >> value;
+    }
+
+    parse_elapsed += bench_clock::now() - start;
+
+    std::ostringstream out;
+
+    start = bench_clock::now();
+
+    for (const BigInt &value : parsed) {
+      out << value << '\n';
+    }
+
+    format_elapsed += bench_clock::now() - start;
+
+    if (out.str() != values) {
+      cout << "round trip failed" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  const double count = static_cast<double>(VALUES) * ROUNDS;
+
+  cout << "2048-bit hex values" << endl;
+  cout << "parse (ns)\t"
+       << std::chrono::duration<double, std::nano>(parse_elapsed).count() /
+              count
+       << endl;
+  cout << "format (ns)\t"
+       << std::chrono::duration<double, std::nano>(format_elapsed).count() /
+              count
+       << endl;
+
+  return EXIT_SUCCESS;
+}
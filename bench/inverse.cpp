@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "bench.hpp"
+#include "modint.hpp"
+#include "modintfactory.hpp"
+
+const size_t BATCH_SIZE = 64;
+
+/*
+Time inverting BATCH_SIZE values one at a time against inverting them
+together with Montgomery's trick, per value. The modulus is odd but not
+prime, so a value may have no inverse, in which case a fresh set is drawn.
+*/
+void compare(BigInt::bit_index_type bits) {
+  BigInt modulus = random_odd(bits);
+
+  ModIntFactory factory(modulus);
+  std::vector<ModInt> values;
+
+  while (values.size() < BATCH_SIZE) {
+    ModInt value = factory.create_int(random_bigint(modulus));
+
+    try {
+      factory.inverse(value);
+      values.push_back(value);
+    } catch (const invalid_argument &) {
+    }
+  }
+
+  std::vector<ModInt> inverses = factory.inverse(values);
+
+  for (size_t i = 0; i < BATCH_SIZE; ++i) {
+    if (static_cast<BigInt>(values[i] * inverses[i]) != 1) {
+      cout << bits << " bits: an inverse is wrong" << endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  double fastest[2] = {1e300, 1e300};
+
+  for (unsigned int batch = 0; batch < BATCHES; ++batch) {
+    bench_clock::time_point start = bench_clock::now();
+
+    for (const ModInt &value : values) {
+      ModInt inverse = factory.inverse(value);
+    }
+
+    fastest[0] = std::min(fastest[0], nanoseconds_since(start, BATCH_SIZE));
+
+    start = bench_clock::now();
+
+    std::vector<ModInt> batch_inverses = factory.inverse(values);
+
+    fastest[1] = std::min(fastest[1], nanoseconds_since(start, BATCH_SIZE));
+  }
+
+  cout << bits << " bits: " << fastest[0] / 1000 << " us per inverse alone, "
+       << fastest[1] / 1000 << " us in a batch of " << BATCH_SIZE << endl;
+}
+
+int main() {
+  seed_generator();
+
+  for (BigInt::bit_index_type bits : {512, 1024, 2048, 4096}) {
+    compare(bits);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#include <cstdlib>
+#include <limits>
+
+#include "bench.hpp"
+
+const unsigned int REQUIRED_WINS = 3;
+
+const BigInt::limbs_size_type NEVER =
+    std::numeric_limits<BigInt::limbs_size_type>::max();
+
+// Time lhs * rhs in nanoseconds, averaged over enough runs to be stable
+double time_multiply(const BigInt &lhs, const BigInt &rhs) {
+  const std::chrono::milliseconds minimum_duration(50);
+
+  unsigned long runs = 0;
+  bench_clock::duration elapsed(0);
+  bench_clock::time_point start = bench_clock::now();
+
+  while (elapsed < minimum_duration) {
+    BigInt product = lhs * rhs;
+    ++runs;
+    elapsed = bench_clock::now() - start;
+  }
+
+  return std::chrono::duration<double, std::nano>(elapsed).count() / runs;
+}
+
+/*
+Find the smallest operand size at which a single level of the faster
+algorithm, with the slower algorithm below it, beats the slower algorithm on
+its own. The faster algorithm is enabled by setting threshold to the size
+being measured.
+*/
+BigInt::limbs_size_type find_crossover(const char *name,
+                                       BigInt::limbs_size_type &threshold,
+                                       BigInt::limbs_size_type first,
+                                       BigInt::limbs_size_type last,
+                                       BigInt::limbs_size_type step) {
+  cout << name << endl;
+  cout << "limbs\tslower (ns)\tfaster (ns)" << endl;
+
+  // Require several wins in a row so a single noisy sample does not decide
+  BigInt::limbs_size_type crossover = NEVER;
+  unsigned int wins = 0;
+
+  for (BigInt::limbs_size_type limbs = first; limbs <= last; limbs += step) {
+    BigInt lhs = random_bits(limbs * BigInt::LIMB_WIDTH),
+           rhs = random_bits(limbs * BigInt::LIMB_WIDTH);
+
+    threshold = NEVER;
+    double slower = time_multiply(lhs, rhs);
+
+    threshold = limbs;
+    double faster = time_multiply(lhs, rhs);
+
+    cout << limbs << "\t" << slower << "\t" << faster << endl;
+
+    if (faster < slower) {
+      if (++wins == 1) {
+        crossover = limbs;
+      } else if (wins == REQUIRED_WINS) {
+        break;
+      }
+    } else {
+      wins = 0;
+      crossover = NEVER;
+    }
+  }
+
+  threshold = crossover;
+
+  return crossover;
+}
+
+int main() {
+  seed_generator(1);
+
+  BigInt::toom_3_threshold = NEVER;
+
+  BigInt::limbs_size_type karatsuba = find_crossover(
+      "Schoolbook against Karatsuba", BigInt::karatsuba_threshold, 8, 128, 4);
+
+  BigInt::limbs_size_type toom_3 = find_crossover(
+      "Karatsuba against Toom-3", BigInt::toom_3_threshold, 96, 1024, 16);
+
+  cout << endl;
+  cout << "karatsuba_threshold = "
+       << (karatsuba == NEVER ? "not found" : std::to_string(karatsuba))
+       << endl;
+  cout << "toom_3_threshold = "
+       << (toom_3 == NEVER ? "not found" : std::to_string(toom_3)) << endl;
+
+  return EXIT_SUCCESS;
+}
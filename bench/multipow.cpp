@@ -0,0 +1,139 @@
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "bench.hpp"
+#include "modint.hpp"
+#include "modintfactory.hpp"
+
+typedef std::vector<std::pair<ModInt, BigInt>> powers_type;
+
+const unsigned int CHECKS_PER_COUNT = 4;
+// Each batch of the larger counts takes a while, so fewer are timed
+const unsigned int TIMING_BATCHES = 5;
+
+// The product of x^n over powers, one exponentiation at a time
+ModInt product_of_pows(const powers_type &powers) {
+  ModInt product = powers.front().first.one();
+
+  for (const auto &power : powers) {
+    product = product * power.first.pow(power.second);
+  }
+
+  return product;
+}
+
+// The method multi_pow uses for count powers with different exponents
+const char *method_name(size_t count) {
+  if (count == 1) {
+    return "pow      ";
+  } else if (count < ModInt::PIPPENGER_THRESHOLD) {
+    return "Straus   ";
+  } else {
+    return "Pippenger";
+  }
+}
+
+/*
+count random powers for a check. Check 0 raises every base to the same
+exponent, which multi_pow takes a shortcut for, and check 1 mixes in zero
+and shorter exponents.
+*/
+powers_type random_powers(const ModIntFactory &factory, size_t count,
+                          BigInt::bit_index_type bits, unsigned int check) {
+  powers_type powers;
+  BigInt shared = random_bits(bits);
+
+  for (size_t i = 0; i < count; ++i) {
+    BigInt n = check == 0 ? shared : random_bits(bits);
+
+    if (check == 1 && i % 3 == 1) {
+      n = i % 2 == 0 ? BigInt(0) : random_bits(bits / 2);
+    }
+
+    powers.push_back(std::make_pair(factory.create_int(random_bits(bits - 1)),
+                                    n));
+  }
+
+  return powers;
+}
+
+/*
+Check multi_pow against a product of single exponentiations over batch sizes
+on either side of PIPPENGER_THRESHOLD and of each step in Pippenger's window
+width, then time the two.
+*/
+void compare(BigInt::bit_index_type bits) {
+  ModIntFactory factory(random_odd(bits));
+
+  cout << bits << "-bit modulus and exponents" << endl;
+  cout << "powers\tmethod\t\tseparate (us)\tmulti_pow (us)" << endl;
+
+  for (size_t count : {1, 2, 31, 255, 256, 257, 511, 512}) {
+    for (unsigned int check = 0; check < CHECKS_PER_COUNT; ++check) {
+      powers_type powers = random_powers(factory, count, bits, check);
+
+      if (static_cast<BigInt>(ModInt::multi_pow(powers)) !=
+          static_cast<BigInt>(product_of_pows(powers))) {
+        cout << count << " powers: multi_pow disagrees on check " << check
+             << endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    powers_type powers = random_powers(factory, count, bits, 2);
+
+    double separate =
+        time_fastest([&]() { product_of_pows(powers); }, 1, TIMING_BATCHES);
+    double multi =
+        time_fastest([&]() { ModInt::multi_pow(powers); }, 1, TIMING_BATCHES);
+
+    cout << count << "\t" << method_name(count) << "\t" << separate / 1000
+         << "\t\t" << multi / 1000 << endl;
+  }
+
+  cout << endl;
+}
+
+/*
+Time Straus' and Pippenger's methods against each other on the same powers,
+which is where PIPPENGER_THRESHOLD should sit.
+*/
+void crossover(BigInt::bit_index_type bits) {
+  ModIntFactory factory(random_odd(bits));
+
+  cout << bits << "-bit modulus and exponents" << endl;
+  cout << "powers\tStraus (us)\tPippenger (us)" << endl;
+
+  for (size_t count : {16, 32, 64, 96, 128, 192, 256, 512, 1024}) {
+    powers_type powers = random_powers(factory, count, bits, 2);
+
+    if (static_cast<BigInt>(ModInt::straus_multi_pow(powers)) !=
+        static_cast<BigInt>(ModInt::pippenger_multi_pow(powers))) {
+      cout << count << " powers: Straus and Pippenger disagree" << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    double straus = time_fastest(
+        [&]() { ModInt::straus_multi_pow(powers); }, 1, TIMING_BATCHES);
+    double pippenger = time_fastest(
+        [&]() { ModInt::pippenger_multi_pow(powers); }, 1, TIMING_BATCHES);
+
+    cout << count << "\t" << straus / 1000 << "\t\t" << pippenger / 1000
+         << endl;
+  }
+
+  cout << endl;
+}
+
+int main() {
+  seed_generator(1);
+
+  compare(512);
+  compare(1024);
+
+  crossover(512);
+  crossover(1024);
+
+  return EXIT_SUCCESS;
+}
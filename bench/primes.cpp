@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+#include "bench.hpp"
+#include "keygenerator.hpp"
+#include "primegenerator.hpp"
+
+const unsigned int RUNS = 10;
+
+/*
+Time key generation, averaged over RUNS keys as the time to find a prime
+varies a lot, on one thread and on every hardware thread. The seed is
+fixed, so single threaded runs find the same primes every time.
+*/
+int main() {
+  seed_generator(1);
+
+  unsigned int hardware_threads =
+      std::max(std::thread::hardware_concurrency(), 1u);
+
+  for (unsigned int threads : {1u, hardware_threads}) {
+    for (BigInt::bit_index_type bits : {1024, 2048, 3072}) {
+      bench_clock::time_point start = bench_clock::now();
+
+      for (unsigned int run = 0; run < RUNS; ++run) {
+        KeyGenerator::rsa(bits, threads);
+      }
+
+      cout << bits << "-bit RSA key, " << threads
+           << " threads: " << nanoseconds_since(start, RUNS) / 1e6 << " ms"
+           << endl;
+    }
+
+    bench_clock::time_point start = bench_clock::now();
+
+    for (unsigned int run = 0; run < RUNS; ++run) {
+      PrimeGenerator::random_safe_prime(512, threads);
+    }
+
+    cout << "512-bit safe prime, " << threads
+         << " threads: " << nanoseconds_since(start, RUNS) / 1e6 << " ms"
+         << endl;
+
+    if (hardware_threads == 1) {
+      break;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,39 @@
+#include <cstdlib>
+#include <vector>
+
+#include "bench.hpp"
+
+const BigInt::limbs_size_type FILL_LIMBS = 1 << 16;
+const unsigned int DRAWS_PER_BATCH = 1000;
+
+/*
+Time filling a large limb array with random_limbs, then drawing random
+integers below a bound of each size with random_bigint. The seed is fixed,
+so every run draws the same numbers.
+*/
+int main() {
+  seed_generator(1);
+
+  std::vector<BigInt::limb_type> limbs(FILL_LIMBS);
+
+  double fill = time_fastest(
+      [&]() { random_limbs(limbs.data(), limbs.size()); }, 1);
+
+  cout << "random_limbs: "
+       << FILL_LIMBS * sizeof(BigInt::limb_type) * 1e9 / fill / (1 << 20)
+       << " MiB/s" << endl;
+
+  for (BigInt::bit_index_type bits : {512, 1024, 2048, 4096}) {
+    // Just over a power of two, the worst case for rejection
+    BigInt range(1);
+    range <<= BigInt::Bits(bits - 1);
+    range += BigInt(1);
+
+    double draw = time_fastest([&]() { BigInt value = random_bigint(range); },
+                               DRAWS_PER_BATCH);
+
+    cout << bits << " bits: " << draw << " ns per random_bigint" << endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+#include <cstdlib>
+
+#include "bench.hpp"
+#include "modintfactory.hpp"
+#include "vectormontgomery.hpp"
+
+const unsigned int CHECKS_PER_SIZE = 50;
+
+const unsigned int RUNS_PER_BATCH = 200;
+
+// Prepares a modulus for a backend's kernels
+typedef BigInt::limbs_type (*kernel_modulus_type)(
+    BigInt::limbs_const_iter_type mod, BigInt::limbs_size_type n);
+
+// The number of random products on which kernel disagrees with BigInt's
+// scalar kernel, over every modulus size it accepts
+unsigned int cross_check(ModIntFactory::multiply_kernel_type kernel,
+                         ModIntFactory::square_kernel_type square_kernel,
+                         kernel_modulus_type kernel_modulus) {
+  unsigned int mismatches = 0;
+
+  for (BigInt::limbs_size_type n = 1; n <= VectorMontgomery::MAX_LIMBS; ++n) {
+    for (unsigned int check = 0; check < CHECKS_PER_SIZE; ++check) {
+      BigInt::limbs_type mod = random_modulus(n);
+      BigInt::limbs_type lhs = random_below(mod), rhs = random_below(mod);
+      BigInt::limb_type mod_neg_inv = -BigInt::mod_inv(mod.front());
+
+      // The operands most likely to overflow an accumulator
+      if (check == 0) {
+        for (BigInt::limb_type &limb : mod) {
+          limb = ~static_cast<BigInt::limb_type>(0);
+        }
+
+        lhs = mod;
+        rhs = mod;
+        lhs.front() -= 2;
+        rhs.front() -= 2;
+        mod_neg_inv = -BigInt::mod_inv(mod.front());
+      }
+
+      BigInt::limbs_type expected(n), actual(n), t(n + 2), square_t;
+      BigInt::limbs_type vector_mod = kernel_modulus(mod.cbegin(), n);
+
+      BigInt::montgomery_multiply_fixed(expected.begin(), lhs.cbegin(),
+                                        rhs.cbegin(), mod.cbegin(), n,
+                                        mod_neg_inv, t.begin());
+      kernel(actual.begin(), lhs.cbegin(), rhs.cbegin(), vector_mod.cbegin(),
+             n, mod_neg_inv, t.begin());
+      mismatches += actual != expected;
+
+      BigInt::montgomery_square_fixed(expected.begin(), lhs.cbegin(),
+                                      mod.cbegin(), n, mod_neg_inv, square_t);
+      square_kernel(actual.begin(), lhs.cbegin(), vector_mod.cbegin(), n,
+                    mod_neg_inv, square_t);
+      mismatches += actual != expected;
+    }
+  }
+
+  return mismatches;
+}
+
+// Time kernel on a random modulus of bits bits, prepared by kernel_modulus
+// unless it's null
+double time_multiply(ModIntFactory::multiply_kernel_type kernel,
+                     kernel_modulus_type kernel_modulus,
+                     BigInt::limbs_size_type bits) {
+  BigInt::limbs_size_type n = bits / BigInt::LIMB_WIDTH;
+
+  BigInt::limbs_type mod = random_modulus(n);
+  BigInt::limbs_type lhs = random_below(mod), rhs = random_below(mod);
+  BigInt::limb_type mod_neg_inv = -BigInt::mod_inv(mod.front());
+  BigInt::limbs_type result(n), t(n + 2);
+
+  if (kernel_modulus != nullptr) {
+    mod = kernel_modulus(mod.cbegin(), n);
+  }
+
+  return time_fastest(
+      [&]() {
+        kernel(result.begin(), lhs.cbegin(), rhs.cbegin(), mod.cbegin(), n,
+               mod_neg_inv, t.begin());
+      },
+      RUNS_PER_BATCH);
+}
+
+/*
+Cross-check each vector backend the CPU supports against the scalar kernels,
+failing on any mismatch, then compare their speed on a multiplication.
+*/
+int main() {
+  seed_generator(1);
+
+  struct Backend {
+    const char *name;
+    bool supported;
+    ModIntFactory::multiply_kernel_type multiply;
+    ModIntFactory::square_kernel_type square;
+    kernel_modulus_type kernel_modulus;
+  };
+
+  const Backend backends[] = {
+      {"avx2", VectorMontgomery::avx2_supported(),
+       &VectorMontgomery::multiply_avx2, &VectorMontgomery::square_avx2,
+       &VectorMontgomery::kernel_modulus_avx2},
+      {"ifma", VectorMontgomery::ifma_supported(),
+       &VectorMontgomery::multiply_ifma, &VectorMontgomery::square_ifma,
+       &VectorMontgomery::kernel_modulus_ifma}};
+
+  bool mismatched = false;
+
+  for (const Backend &backend : backends) {
+    if (!backend.supported) {
+      cout << backend.name << ": not supported" << endl;
+    } else {
+      unsigned int mismatches = cross_check(backend.multiply, backend.square,
+                                            backend.kernel_modulus);
+
+      cout << backend.name << ": " << mismatches
+           << " mismatches with the scalar kernels" << endl;
+
+      mismatched = mismatched || mismatches > 0;
+    }
+  }
+
+  if (mismatched) {
+    return EXIT_FAILURE;
+  }
+
+  cout << "bits\tscalar (ns)";
+
+  for (const Backend &backend : backends) {
+    if (backend.supported) {
+      cout << "\t" << backend.name << " (ns)";
+    }
+  }
+
+  cout << endl;
+
+  for (BigInt::limbs_size_type bits : {512, 1024, 2048, 4096}) {
+    cout << bits << "\t"
+         << time_multiply(&BigInt::montgomery_multiply_fixed, nullptr, bits);
+
+    for (const Backend &backend : backends) {
+      if (backend.supported) {
+        cout << "\t\t"
+             << time_multiply(backend.multiply, backend.kernel_modulus, bits);
+      }
+    }
+
+    cout << endl;
+  }
+
+  return EXIT_SUCCESS;
+}
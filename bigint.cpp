@@ -2,35 +2,48 @@
 
 BigInt::Limbs::Limbs(const unsigned int quantity) : quantity(quantity) {}
 
+BigInt::Bits::Bits(const bit_index_type quantity) : quantity(quantity) {}
+
+const int8_t BigInt::HEX_DIGIT_VALUES[UCHAR_MAX + 1] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+
+const char BigInt::HEX_DIGIT_PAIRS[] =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
 BigInt::BigInt(uint64_t n) {
-  while (n > 0) {
-    limbs.push_back(n & LIMB_MASK);
-    n >>= LIMB_WIDTH;
+  if (n > 0) {
+    limbs.push_back(n);
   }
 }
 
 BigInt::BigInt(const string &str) {
-  if (!str.empty()) {
-    size_t n = str.length() - HEX_CHARS_PER_LIMB;
-
-    while (true) {
-      append_limb(str.substr(n, HEX_CHARS_PER_LIMB));
-
-      if (n <= HEX_CHARS_PER_LIMB) {
-        break;
-      } else {
-        n -= HEX_CHARS_PER_LIMB;
-      }
-    }
-
-    if (n > 0) {
-      append_limb(str.substr(0, n));
-    }
-  }
+  assign_hex(str.data(), str.data() + str.length());
 }
 
 BigInt::limbs_const_iter_type BigInt::most_significant_limb() const {
-  return first_non_zero(limbs.cbegin(), limbs.cend());
+  return significant_end(limbs.cbegin(), limbs.cend()) - 1;
 }
 
 BigInt::limbs_const_iter_type BigInt::least_significant_limb() const {
@@ -42,8 +55,8 @@ BigInt::limb_type BigInt::least_significant_limb_value() const {
 }
 
 void BigInt::maybe_add_leading_zero(limbs_type &limbs, limbs_index_type index) {
-  while (index >= limbs.size()) {
-    limbs.push_back(0);
+  if (index >= limbs.size()) {
+    limbs.resize(index + 1, 0);
   }
 }
 
@@ -58,15 +71,118 @@ void BigInt::append_limb(string limb_str) {
     throw invalid_argument("limb string cannot be empty");
   }
 
-  char *limb_end = NULL;
+  if (limb_str.length() > HEX_CHARS_PER_LIMB) {
+    throw invalid_argument("limb value out of range");
+  }
+
+  append_limb(parse_limb(limb_str.data(), limb_str.data() + limb_str.length()));
+}
+
+BigInt::limb_type BigInt::parse_limb(const char *start, const char *end) {
+  limb_type limb = 0;
+  // Any invalid character makes this negative, checked once at the end
+  int8_t digits_or = 0;
+
+  for (; start != end; ++start) {
+    int8_t digit = HEX_DIGIT_VALUES[static_cast<unsigned char>(*start)];
 
-  unsigned long int limb = strtoul(limb_str.data(), &limb_end, HEX_MODULUS);
+    digits_or |= digit;
+    limb = (limb << HEX_BITS) | static_cast<uint8_t>(digit);
+  }
 
-  if (*limb_end != 0) {
+  if (digits_or < 0) {
     throw invalid_argument("limb string contains invalid character");
   }
 
-  append_limb(limb);
+  return limb;
+}
+
+char *BigInt::format_limb(limb_type limb, char *out) {
+  // Two digits at a time, from the least significant byte
+  for (bit_count_type n = HEX_CHARS_PER_LIMB; n > 0; n -= 2) {
+    const char *pair = HEX_DIGIT_PAIRS + 2 * (limb & UCHAR_MAX);
+
+    out[n - 2] = pair[0];
+    out[n - 1] = pair[1];
+    limb >>= CHAR_BIT;
+  }
+
+  return out + HEX_CHARS_PER_LIMB;
+}
+
+void BigInt::assign_hex(const char *start, const char *end) {
+  limbs.resize((end - start + HEX_CHARS_PER_LIMB - 1) / HEX_CHARS_PER_LIMB);
+
+  // Fill from the least significant limb, which is at the end of the string
+  for (limb_type &limb : limbs) {
+    const char *limb_start =
+        end - start > HEX_CHARS_PER_LIMB ? end - HEX_CHARS_PER_LIMB : start;
+
+    limb = parse_limb(limb_start, end);
+    end = limb_start;
+  }
+
+  trim();
+}
+
+void BigInt::assign_limbs(const char *start, limbs_size_type count) {
+  limbs.resize(count);
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  memcpy(limbs.data(), start, count * sizeof(limb_type));
+#else
+  for (limb_type &limb : limbs) {
+    limb = 0;
+
+    for (size_t byte = sizeof(limb_type); byte > 0; --byte) {
+      limb = (limb << CHAR_BIT) | static_cast<unsigned char>(start[byte - 1]);
+    }
+
+    start += sizeof(limb_type);
+  }
+#endif
+
+  trim();
+}
+
+BigInt::limbs_size_type BigInt::significant_limb_count() const {
+  return significant_end(limbs.cbegin(), limbs.cend()) - limbs.cbegin();
+}
+
+void BigInt::assign(limbs_const_iter_type start, limbs_const_iter_type end) {
+  limbs.assign(start, end);
+  trim();
+}
+
+void BigInt::copy_limbs(limbs_iter_type out, limbs_size_type n) const {
+  limbs_size_type count = significant_limb_count();
+
+  if (count > n) {
+    throw range_error("Value has more than the requested number of limbs");
+  }
+
+  out = std::copy(limbs.cbegin(), limbs.cbegin() + count, out);
+  std::fill_n(out, n - count, 0);
+}
+
+char *BigInt::store_limbs(char *out) const {
+  limbs_size_type count = significant_limb_count();
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  memcpy(out, limbs.data(), count * sizeof(limb_type));
+  out += count * sizeof(limb_type);
+#else
+  for (limbs_index_type n = 0; n < count; ++n) {
+    limb_type limb = limbs[n];
+
+    for (size_t byte = 0; byte < sizeof(limb_type); ++byte) {
+      *out++ = static_cast<char>(limb & UCHAR_MAX);
+      limb >>= CHAR_BIT;
+    }
+  }
+#endif
+
+  return out;
 }
 
 void BigInt::append_limb(unsigned long int limb) {
@@ -77,33 +193,60 @@ void BigInt::append_limb(unsigned long int limb) {
   limbs.push_back(limb);
 }
 
-void BigInt::split_double_limb(double_limb_type d, double_limb_type &large,
-                               limb_type &small) {
-  small = d & LIMB_MASK;
-  large = (d >> LIMB_WIDTH) & LIMB_MASK;
+BigInt::limbs_const_iter_type
+BigInt::significant_end(limbs_const_iter_type start,
+                        limbs_const_iter_type end) {
+  while (end != start && *(end - 1) == 0) {
+    --end;
+  }
+
+  return end;
 }
 
-BigInt::limbs_const_iter_type
-BigInt::first_non_zero(limbs_const_iter_type start, limbs_const_iter_type end) {
-  limbs_const_iter_type iter = end;
-  --iter;
-  while (iter >= start && *iter == 0) {
-    --iter;
+void BigInt::shift_left(limbs_type &result, limbs_const_iter_type start,
+                        limbs_const_iter_type end, bit_count_type bits) {
+  limbs_type shifted(end - start + 1, 0);
+
+  limbs_type::iterator shifted_iter = shifted.begin();
+
+  for (; start != end; ++start, ++shifted_iter) {
+    *shifted_iter |= *start << bits;
+
+    if (bits > 0) {
+      *(shifted_iter + 1) = *start >> (LIMB_WIDTH - bits);
+    }
+  }
+
+  result.swap(shifted);
+}
+
+void BigInt::shift_right(limbs_type &result, limbs_const_iter_type start,
+                         limbs_const_iter_type end, bit_count_type bits) {
+  limbs_type shifted(end - start, 0);
+
+  limbs_type::iterator shifted_iter = shifted.begin();
+
+  for (; start != end; ++start, ++shifted_iter) {
+    *shifted_iter = *start >> bits;
+
+    if (bits > 0 && start + 1 != end) {
+      *shifted_iter |= *(start + 1) << (LIMB_WIDTH - bits);
+    }
   }
 
-  return iter;
+  result.swap(shifted);
 }
 
 BigInt::Comparison BigInt::compare(limbs_const_iter_type lhs_start,
                                    limbs_const_iter_type lhs_end,
                                    limb_type rhs) {
-  limbs_const_iter_type lhs_iter = first_non_zero(lhs_start, lhs_end);
+  lhs_end = significant_end(lhs_start, lhs_end);
 
-  switch (compare<limbs_const_iter_type>(lhs_iter, lhs_start)) {
+  switch (compare<limbs_index_difference_type>(lhs_end - lhs_start, 1)) {
     case Comparison::LESS_THAN:
       return compare<limb_type>(0, rhs);
     case Comparison::EQUALS:
-      return compare<limb_type>(*lhs_iter, rhs);
+      return compare<limb_type>(*lhs_start, rhs);
     default:
       return Comparison::GREATER_THAN;
   }
@@ -113,27 +256,24 @@ BigInt::Comparison BigInt::compare(limbs_const_iter_type lhs_start,
                                    limbs_const_iter_type lhs_end,
                                    limbs_const_iter_type rhs_start,
                                    limbs_const_iter_type rhs_end) {
-  limbs_const_iter_type lhs_iter = first_non_zero(lhs_start, lhs_end);
-  limbs_const_iter_type rhs_iter = first_non_zero(rhs_start, rhs_end);
-
-  limbs_const_iter_type::difference_type lhs_length = lhs_iter - lhs_start + 1;
-  limbs_const_iter_type::difference_type rhs_length = rhs_iter - rhs_start + 1;
+  lhs_end = significant_end(lhs_start, lhs_end);
+  rhs_end = significant_end(rhs_start, rhs_end);
 
-  Comparison length_comparison =
-      compare<limbs_index_difference_type>(lhs_length, rhs_length);
+  Comparison length_comparison = compare<limbs_index_difference_type>(
+      lhs_end - lhs_start, rhs_end - rhs_start);
 
   if (length_comparison != Comparison::EQUALS) {
     return length_comparison;
   } else {
-    while (lhs_iter >= lhs_start && rhs_iter >= rhs_start) {
-      Comparison value_comparison = compare<limb_type>(*lhs_iter, *rhs_iter);
+    while (lhs_end != lhs_start) {
+      --lhs_end;
+      --rhs_end;
+
+      Comparison value_comparison = compare<limb_type>(*lhs_end, *rhs_end);
 
       if (value_comparison != Comparison::EQUALS) {
         return value_comparison;
       }
-
-      --lhs_iter;
-      --rhs_iter;
     }
 
     return Comparison::EQUALS;
@@ -191,28 +331,73 @@ bool operator>=(const BigInt &lhs, BigInt::limb_type rhs) {
 
 bool operator>=(const BigInt &lhs, const BigInt &rhs) { return !(lhs < rhs); }
 
+BigInt::limb_type BigInt::add_limbs(limbs_iter_type acc_iter,
+                                    limbs_const_iter_type rhs_iter,
+                                    limbs_const_iter_type rhs_end,
+                                    limb_type carry) {
+  for (; rhs_iter != rhs_end; ++rhs_iter, ++acc_iter) {
+    double_limb_type sum =
+        static_cast<double_limb_type>(*acc_iter) + *rhs_iter + carry;
+
+    *acc_iter = static_cast<limb_type>(sum);
+    carry = static_cast<limb_type>(sum >> LIMB_WIDTH);
+  }
+
+  return carry;
+}
+
+BigInt::limb_type BigInt::subtract_limbs(limbs_iter_type acc_iter,
+                                         limbs_const_iter_type rhs_iter,
+                                         limbs_const_iter_type rhs_end,
+                                         limb_type borrow) {
+  for (; rhs_iter != rhs_end; ++rhs_iter, ++acc_iter) {
+    double_limb_type difference =
+        static_cast<double_limb_type>(*acc_iter) - *rhs_iter - borrow;
+
+    *acc_iter = static_cast<limb_type>(difference);
+    // A negative difference wraps around, setting every high bit
+    borrow = static_cast<limb_type>(difference >> LIMB_WIDTH) & 1;
+  }
+
+  return borrow;
+}
+
+BigInt::limb_type BigInt::multiply_add_limbs(limbs_iter_type acc_iter,
+                                             limbs_const_iter_type lhs_iter,
+                                             limbs_const_iter_type lhs_end,
+                                             limb_type rhs) {
+  return multiply_add_n(acc_iter, lhs_iter,
+                        static_cast<limbs_size_type>(lhs_end - lhs_iter), rhs);
+}
+
 void BigInt::add_limb(limbs_type &lhs_limbs, limbs_index_type lhs_index,
                       double_limb_type rhs) {
-  if (rhs > 0) {
+  while (rhs > 0) {
     maybe_add_leading_zero(lhs_limbs, lhs_index);
-    double_limb_type carry = 0;
 
-    split_double_limb(rhs + lhs_limbs[lhs_index], carry, lhs_limbs[lhs_index]);
+    rhs += lhs_limbs[lhs_index];
 
-    if (carry > 0) {
-      add_limb(lhs_limbs, lhs_index + 1, carry);
-    }
+    lhs_limbs[lhs_index] = static_cast<limb_type>(rhs);
+    rhs >>= LIMB_WIDTH;
+
+    ++lhs_index;
   }
 }
 
 void BigInt::add_big_int(limbs_type &lhs_limbs, limbs_index_type lhs_index,
                          limbs_const_iter_type rhs_iter,
                          limbs_const_iter_type rhs_end) {
-  while (rhs_iter < rhs_end) {
-    add_limb(lhs_limbs, lhs_index, *rhs_iter);
+  rhs_end = significant_end(rhs_iter, rhs_end);
 
-    ++lhs_index;
-    ++rhs_iter;
+  if (rhs_iter != rhs_end) {
+    limbs_index_type rhs_end_index = lhs_index + (rhs_end - rhs_iter);
+
+    maybe_add_leading_zero(lhs_limbs, rhs_end_index - 1);
+
+    limb_type carry =
+        add_limbs(lhs_limbs.begin() + lhs_index, rhs_iter, rhs_end, 0);
+
+    add_limb(lhs_limbs, rhs_end_index, carry);
   }
 }
 
@@ -223,6 +408,12 @@ BigInt &BigInt::operator+=(limb_type rhs) {
 }
 
 BigInt &BigInt::operator+=(const BigInt &rhs) {
+  if (this == &rhs) {
+    // Growing limbs would invalidate the iterators into rhs
+    BigInt rhs_copy = rhs;
+    return *this += rhs_copy;
+  }
+
   add_big_int(limbs, 0, rhs.limbs.cbegin(), rhs.limbs.cend());
 
   return *this;
@@ -242,28 +433,36 @@ BigInt operator+(const BigInt &lhs, const BigInt &rhs) {
 
 void BigInt::subtract_limb(limbs_type &lhs_limbs, limbs_index_type lhs_index,
                            limb_type rhs) {
-  if (rhs > 0) {
+  while (rhs > 0) {
     if (lhs_index == lhs_limbs.size()) {
       throw underflow_error("Negative number occurred when subtracting");
-    } else if (rhs <= lhs_limbs[lhs_index]) {
-      lhs_limbs[lhs_index] -= rhs;
-    } else {
-      lhs_limbs[lhs_index] += LIMB_MODULUS - rhs;
-
-      subtract_limb(lhs_limbs, lhs_index + 1, 1);
     }
+
+    limb_type lhs = lhs_limbs[lhs_index];
+
+    // Wraps around mod LIMB_MODULUS
+    lhs_limbs[lhs_index] = lhs - rhs;
+    rhs = lhs < rhs ? 1 : 0;
+
+    ++lhs_index;
   }
 }
 
 void BigInt::subtract_big_int(limbs_type &lhs_limbs, limbs_index_type lhs_index,
                               limbs_const_iter_type rhs_iter,
                               limbs_const_iter_type rhs_end) {
-  while (rhs_iter != rhs_end) {
-    subtract_limb(lhs_limbs, lhs_index, *rhs_iter);
+  rhs_end = significant_end(rhs_iter, rhs_end);
 
-    ++lhs_index;
-    ++rhs_iter;
+  limbs_index_type rhs_end_index = lhs_index + (rhs_end - rhs_iter);
+
+  if (rhs_end_index > lhs_limbs.size()) {
+    throw underflow_error("Negative number occurred when subtracting");
   }
+
+  limb_type borrow =
+      subtract_limbs(lhs_limbs.begin() + lhs_index, rhs_iter, rhs_end, 0);
+
+  subtract_limb(lhs_limbs, rhs_end_index, borrow);
 }
 
 BigInt &BigInt::operator-=(limb_type rhs) {
@@ -294,10 +493,14 @@ void BigInt::multiply_by_limb(limbs_type &acc_limbs, limbs_index_type acc_index,
                               limbs_const_iter_type lhs_iter,
                               limbs_const_iter_type lhs_end, limb_type rhs) {
   if (lhs_iter != lhs_end) {
-    add_limb(acc_limbs, acc_index,
-             static_cast<double_limb_type>(rhs) * *lhs_iter);
+    limbs_index_type lhs_end_index = acc_index + (lhs_end - lhs_iter);
 
-    multiply_by_limb(acc_limbs, acc_index + 1, lhs_iter + 1, lhs_end, rhs);
+    maybe_add_leading_zero(acc_limbs, lhs_end_index - 1);
+
+    limb_type carry = multiply_add_limbs(acc_limbs.begin() + acc_index,
+                                         lhs_iter, lhs_end, rhs);
+
+    add_limb(acc_limbs, lhs_end_index, carry);
   }
 }
 
@@ -307,69 +510,661 @@ void BigInt::multiply_by_big_int(limbs_type &acc_limbs,
                                  limbs_const_iter_type lhs_end,
                                  limbs_const_iter_type rhs_iter,
                                  limbs_const_iter_type rhs_end) {
-  while (rhs_iter != rhs_end) {
-    multiply_by_limb(acc_limbs, acc_index, lhs_iter, lhs_end, *rhs_iter);
+  if (lhs_iter != lhs_end && rhs_iter != rhs_end) {
+    limbs_index_type lhs_length = lhs_end - lhs_iter;
+
+    // Size the accumulator for the whole product up front
+    maybe_add_leading_zero(acc_limbs,
+                           acc_index + lhs_length + (rhs_end - rhs_iter) - 1);
 
-    ++acc_index;
-    ++rhs_iter;
+    for (; rhs_iter != rhs_end; ++rhs_iter, ++acc_index) {
+      limb_type carry = multiply_add_limbs(acc_limbs.begin() + acc_index,
+                                           lhs_iter, lhs_end, *rhs_iter);
+
+      add_limb(acc_limbs, acc_index + lhs_length, carry);
+    }
   }
 }
 
 BigInt BigInt::operator*(limb_type rhs) const {
   BigInt result;
   multiply_by_limb(result.limbs, 0, limbs.cbegin(), limbs.cend(), rhs);
+  result.trim();
   return result;
 }
 
 BigInt BigInt::operator*(const BigInt &rhs) const {
+  return multiply(*this, rhs);
+}
+
+// The medians of 19 runs of bench/multiply on a single core x86-64 virtual
+// machine. Single runs put Toom-3's crossover anywhere from 256 to 752 limbs,
+// as one level of it is within a few percent of Karatsuba over that range.
+BigInt::limbs_size_type BigInt::karatsuba_threshold = 52;
+BigInt::limbs_size_type BigInt::toom_3_threshold = 384;
+
+BigInt BigInt::multiply(const BigInt &lhs, const BigInt &rhs) {
+  limbs_const_iter_type lhs_end =
+      significant_end(lhs.limbs.cbegin(), lhs.limbs.cend());
+  limbs_const_iter_type rhs_end =
+      significant_end(rhs.limbs.cbegin(), rhs.limbs.cend());
+
+  limbs_size_type lhs_length = lhs_end - lhs.limbs.cbegin();
+  limbs_size_type rhs_length = rhs_end - rhs.limbs.cbegin();
+
+  if (lhs_length < rhs_length) {
+    return multiply(rhs, lhs);
+  }
+
   BigInt result;
 
-  multiply_by_big_int(result.limbs, 0, limbs.cbegin(), limbs.cend(),
-                      rhs.limbs.cbegin(), rhs.limbs.cend());
+  // Below four limbs the split operands would be no smaller
+  if (rhs_length < std::max<limbs_size_type>(karatsuba_threshold, 4)) {
+    multiply_by_big_int(result.limbs, 0, lhs.limbs.cbegin(), lhs_end,
+                        rhs.limbs.cbegin(), rhs_end);
+  } else if (lhs_length >= 2 * rhs_length) {
+    // Too unbalanced to split evenly, so multiply rhs-sized pieces of lhs
+    for (limbs_index_type offset = 0; offset < lhs_length;
+         offset += rhs_length) {
+      BigInt product = multiply(slice(lhs, offset, rhs_length), rhs);
+
+      add_big_int(result.limbs, offset, product.limbs.cbegin(),
+                  product.limbs.cend());
+    }
+  } else if (rhs_length < toom_3_threshold) {
+    result = karatsuba_multiply(lhs, rhs, (lhs_length + 1) / 2);
+  } else {
+    result = toom_3_multiply(lhs, rhs, (lhs_length + 2) / 3);
+  }
+
+  result.trim();
   return result;
 }
 
-BigInt::limb_type BigInt::short_division(limbs_type &lhs_limbs,
-                                         limbs_index_type lhs_index,
-                                         limbs_const_iter_type rhs_start,
-                                         limbs_const_iter_type rhs_end) {
-  limb_type result = 0;
+// https://en.wikipedia.org/wiki/Karatsuba_algorithm
+BigInt BigInt::karatsuba_multiply(const BigInt &lhs, const BigInt &rhs,
+                                  limbs_size_type m) {
+  BigInt lhs_0 = slice(lhs, 0, m), lhs_1 = slice(lhs, m, m);
+  BigInt rhs_0 = slice(rhs, 0, m), rhs_1 = slice(rhs, m, m);
 
-  if (rhs_start > first_non_zero(rhs_start, rhs_end)) {
-    throw domain_error("Divide by zero!");
+  BigInt z_0 = multiply(lhs_0, rhs_0);
+  BigInt z_2 = multiply(lhs_1, rhs_1);
+
+  // z_1 = (lhs_0 + lhs_1)(rhs_0 + rhs_1) - z_0 - z_2
+  lhs_0 += lhs_1;
+  rhs_0 += rhs_1;
+
+  BigInt z_1 = multiply(lhs_0, rhs_0);
+  z_1 -= z_0;
+  z_1 -= z_2;
+
+  add_big_int(z_0.limbs, m, z_1.limbs.cbegin(), z_1.limbs.cend());
+  add_big_int(z_0.limbs, 2 * m, z_2.limbs.cbegin(), z_2.limbs.cend());
+
+  return z_0;
+}
+
+void BigInt::square_limbs(limbs_type &acc_limbs, limbs_const_iter_type start,
+                          limbs_const_iter_type end) {
+  limbs_size_type n = end - start;
+
+  acc_limbs.assign(2 * n, 0);
+
+  square_n(acc_limbs.begin(), start, n);
+}
+
+BigInt BigInt::square() const {
+  limbs_const_iter_type end = significant_end(limbs.cbegin(), limbs.cend());
+
+  limbs_size_type length = end - limbs.cbegin();
+
+  BigInt result;
+
+  if (length < std::max<limbs_size_type>(karatsuba_threshold, 4)) {
+    square_limbs(result.limbs, limbs.cbegin(), end);
+  } else if (length < toom_3_threshold) {
+    result = karatsuba_square(*this, (length + 1) / 2);
+  } else {
+    result = toom_3_multiply(*this, *this, (length + 2) / 3);
+  }
+
+  result.trim();
+  return result;
+}
+
+BigInt BigInt::karatsuba_square(const BigInt &value, limbs_size_type m) {
+  BigInt value_0 = slice(value, 0, m), value_1 = slice(value, m, m);
+
+  BigInt z_0 = value_0.square();
+  BigInt z_2 = value_1.square();
+
+  // z_1 = (value_0 + value_1)^2 - z_0 - z_2 = 2 value_0 value_1
+  value_0 += value_1;
+
+  BigInt z_1 = value_0.square();
+  z_1 -= z_0;
+  z_1 -= z_2;
+
+  add_big_int(z_0.limbs, m, z_1.limbs.cbegin(), z_1.limbs.cend());
+  add_big_int(z_0.limbs, 2 * m, z_2.limbs.cbegin(), z_2.limbs.cend());
+
+  return z_0;
+}
+
+// Toom-Cook with the evaluation points 0, 1, 2, 3 and infinity. As every
+// coefficient of the product polynomial is non-negative, interpolating at
+// these points never produces a negative intermediate value.
+// https://en.wikipedia.org/wiki/Toom%E2%80%93Cook_multiplication
+BigInt BigInt::toom_3_multiply(const BigInt &lhs, const BigInt &rhs,
+                               limbs_size_type k) {
+  BigInt lhs_parts[3] = {slice(lhs, 0, k), slice(lhs, k, k),
+                         slice(lhs, 2 * k, k)};
+  BigInt rhs_parts[3] = {slice(rhs, 0, k), slice(rhs, k, k),
+                         slice(rhs, 2 * k, k)};
+
+  // Evaluate p(x) = p_0 + p_1 x + p_2 x^2 at x = 1, 2, 3
+  BigInt lhs_values[3], rhs_values[3];
+
+  for (limb_type x = 1; x <= 3; ++x) {
+    lhs_values[x - 1] = lhs_parts[0] + (lhs_parts[1] + lhs_parts[2] * x) * x;
+    rhs_values[x - 1] = rhs_parts[0] + (rhs_parts[1] + rhs_parts[2] * x) * x;
+  }
+
+  BigInt c_0 = multiply(lhs_parts[0], rhs_parts[0]);
+  BigInt c_4 = multiply(lhs_parts[2], rhs_parts[2]);
+
+  // s_x = (r(x) - c_0 - c_4 x^4) / x = c_1 + c_2 x + c_3 x^2
+  BigInt s[3];
+
+  for (limb_type x = 1; x <= 3; ++x) {
+    BigInt r = multiply(lhs_values[x - 1], rhs_values[x - 1]);
+
+    r -= c_0;
+    r -= c_4 * (x * x * x * x);
+
+    limbs_type quotient;
+    divide_by_limb(r.limbs, quotient, x);
+    s[x - 1].limbs.swap(quotient);
+  }
+
+  // t_1 = c_2 + 3 c_3, t_2 = c_2 + 5 c_3
+  BigInt t_1 = s[1] - s[0];
+  BigInt t_2 = s[2] - s[1];
+
+  BigInt c_3 = t_2 - t_1;
+  c_3 >>= Bits(1);
+
+  BigInt c_2 = t_1 - c_3 * 3;
+
+  BigInt c_1 = s[0] - c_2;
+  c_1 -= c_3;
+
+  add_big_int(c_0.limbs, k, c_1.limbs.cbegin(), c_1.limbs.cend());
+  add_big_int(c_0.limbs, 2 * k, c_2.limbs.cbegin(), c_2.limbs.cend());
+  add_big_int(c_0.limbs, 3 * k, c_3.limbs.cbegin(), c_3.limbs.cend());
+  add_big_int(c_0.limbs, 4 * k, c_4.limbs.cbegin(), c_4.limbs.cend());
+
+  return c_0;
+}
+
+void BigInt::montgomery_multiply(BigInt &result, const BigInt &lhs,
+                                 const BigInt &rhs, const BigInt &mod,
+                                 limb_type mod_neg_inv) {
+  if (&result == &lhs || &result == &rhs) {
+    BigInt product;
+    montgomery_multiply(product, lhs, rhs, mod, mod_neg_inv);
+    result.limbs.swap(product.limbs);
+    return;
+  }
+
+  limbs_size_type n = mod.limbs.size();
+
+  limbs_const_iter_type lhs_end =
+      significant_end(lhs.limbs.cbegin(), lhs.limbs.cend());
+  limbs_size_type lhs_length = lhs_end - lhs.limbs.cbegin();
+  limbs_size_type rhs_length =
+      significant_end(rhs.limbs.cbegin(), rhs.limbs.cend()) -
+      rhs.limbs.cbegin();
+
+  // Coarsely Integrated Operand Scanning: t < 2 mod always fits in n + 2 limbs
+  limbs_type &t = result.limbs;
+  t.assign(n + 2, 0);
+
+  for (limbs_index_type i = 0; i < n; ++i) {
+    // t += lhs * rhs_i
+    limb_type carry =
+        multiply_add_limbs(t.begin(), lhs.limbs.cbegin(), lhs_end,
+                           i < rhs_length ? rhs.limbs[i] : 0);
+
+    for (limbs_index_type j = lhs_length; carry != 0; ++j) {
+      double_limb_type sum = static_cast<double_limb_type>(t[j]) + carry;
+
+      t[j] = static_cast<limb_type>(sum);
+      carry = static_cast<limb_type>(sum >> LIMB_WIDTH);
+    }
+
+    // t = (t + m mod) / β, where m is chosen to make the low limb zero
+    limb_type m = t[0] * mod_neg_inv;
+
+    double_limb_type sum =
+        static_cast<double_limb_type>(m) * mod.limbs[0] + t[0];
+    carry = static_cast<limb_type>(sum >> LIMB_WIDTH);
+
+    for (limbs_index_type j = 1; j < n; ++j) {
+      sum = static_cast<double_limb_type>(m) * mod.limbs[j] + t[j] + carry;
+
+      t[j - 1] = static_cast<limb_type>(sum);
+      carry = static_cast<limb_type>(sum >> LIMB_WIDTH);
+    }
+
+    sum = static_cast<double_limb_type>(t[n]) + carry;
+
+    t[n - 1] = static_cast<limb_type>(sum);
+    t[n] = t[n + 1] + static_cast<limb_type>(sum >> LIMB_WIDTH);
+    t[n + 1] = 0;
+  }
+
+  if (compare(t.cbegin(), t.cend(), mod.limbs.cbegin(), mod.limbs.cend()) !=
+      Comparison::LESS_THAN) {
+    subtract_big_int(t, 0, mod.limbs.cbegin(), mod.limbs.cend());
+  }
+
+  remove_leading_zeros(t);
+}
+
+void BigInt::montgomery_reduce(BigInt &value, const BigInt &mod,
+                               limb_type mod_neg_inv) {
+  limbs_size_type n = mod.limbs.size();
+
+  limbs_type &t = value.limbs;
+  remove_leading_zeros(t);
+
+  if (t.size() > 2 * n) {
+    // Too large for a single reduction, but congruent values reduce alike
+    value %= mod;
+  }
+
+  t.resize(2 * n + 1, 0);
+
+  montgomery_reduce_fixed(t.begin(), t.begin(), mod.limbs.cbegin(), n,
+                          mod_neg_inv);
+
+  t.resize(n);
+  remove_leading_zeros(t);
+}
+
+void BigInt::montgomery_reduce_fixed(limbs_iter_type result,
+                                     limbs_iter_type t,
+                                     limbs_const_iter_type mod,
+                                     limbs_size_type n,
+                                     limb_type mod_neg_inv) {
+  montgomery_reduce_n(result, t, mod, n, mod_neg_inv);
+}
+
+void BigInt::montgomery_square_fixed(limbs_iter_type result,
+                                     limbs_const_iter_type value,
+                                     limbs_const_iter_type mod,
+                                     limbs_size_type n,
+                                     limb_type mod_neg_inv, limbs_type &t) {
+  square_limbs(t, value, value + n);
+  t.push_back(0);
+
+  montgomery_reduce_fixed(result, t.begin(), mod, n, mod_neg_inv);
+}
+
+void BigInt::subtract_if_not_less(limbs_iter_type result,
+                                  limbs_const_iter_type t,
+                                  limbs_const_iter_type mod,
+                                  limbs_size_type n) {
+  subtract_if_not_less_n(result, t, mod, n);
+}
+
+void BigInt::montgomery_multiply_fixed(limbs_iter_type result,
+                                       limbs_const_iter_type lhs,
+                                       limbs_const_iter_type rhs,
+                                       limbs_const_iter_type mod,
+                                       limbs_size_type n,
+                                       limb_type mod_neg_inv,
+                                       limbs_iter_type t) {
+  std::fill(t, t + n + 2, 0);
+
+  for (limbs_index_type i = 0; i < n; ++i) {
+    // t += lhs * rhs_i
+    limb_type carry = multiply_add_limbs(t, lhs, lhs + n, rhs[i]);
+
+    double_limb_type sum = static_cast<double_limb_type>(t[n]) + carry;
+
+    t[n] = static_cast<limb_type>(sum);
+    t[n + 1] = static_cast<limb_type>(sum >> LIMB_WIDTH);
+
+    // t = (t + m mod) / β, where m is chosen to make the low limb zero
+    limb_type m = t[0] * mod_neg_inv;
+
+    sum = static_cast<double_limb_type>(m) * mod[0] + t[0];
+    carry = static_cast<limb_type>(sum >> LIMB_WIDTH);
+
+    for (limbs_index_type j = 1; j < n; ++j) {
+      sum = static_cast<double_limb_type>(m) * mod[j] + t[j] + carry;
+
+      t[j - 1] = static_cast<limb_type>(sum);
+      carry = static_cast<limb_type>(sum >> LIMB_WIDTH);
+    }
+
+    sum = static_cast<double_limb_type>(t[n]) + carry;
+
+    t[n - 1] = static_cast<limb_type>(sum);
+    t[n] = t[n + 1] + static_cast<limb_type>(sum >> LIMB_WIDTH);
+  }
+
+  // lhs and rhs have been read for the last time, so result can alias them
+  subtract_if_not_less(result, t, mod, n);
+}
+void BigInt::select_limbs(limbs_iter_type result, limbs_const_iter_type table,
+                          limbs_size_type n, limbs_size_type count,
+                          limb_type index) {
+  std::fill(result, result + n, 0);
+
+  for (limb_type entry = 0; entry < count; ++entry, table += n) {
+    // All ones for the wanted entry and zero otherwise, without comparing
+    limb_type difference = entry ^ index;
+    limb_type mask =
+        ((difference | (0 - difference)) >> (LIMB_WIDTH - 1)) - 1;
+
+    for (limbs_index_type j = 0; j < n; ++j) {
+      result[j] |= table[j] & mask;
+    }
+  }
+}
+
+BigInt::limb_type BigInt::window_limbs(limbs_const_iter_type limbs,
+                                       bit_index_type position,
+                                       bit_count_type width) {
+  limbs_index_type limb_index = position / LIMB_WIDTH;
+  bit_count_type shift = position % LIMB_WIDTH;
+
+  limb_type bits = limbs[limb_index] >> shift;
+
+  // The window straddles into the next limb
+  if (shift + width > LIMB_WIDTH) {
+    bits |= limbs[limb_index + 1] << (LIMB_WIDTH - shift);
+  }
+
+  return width == LIMB_WIDTH ? bits
+                             : bits & ((static_cast<limb_type>(1) << width) - 1);
+}
+
+BigInt::limb_type BigInt::subtract_multiply_limbs(
+    limbs_iter_type acc_iter, limbs_const_iter_type lhs_iter,
+    limbs_const_iter_type lhs_end, limb_type rhs) {
+  limb_type borrow = 0;
+
+  for (; lhs_iter != lhs_end; ++lhs_iter, ++acc_iter) {
+    double_limb_type product =
+        static_cast<double_limb_type>(*lhs_iter) * rhs + borrow;
+
+    limb_type product_low = static_cast<limb_type>(product);
+    limb_type acc = *acc_iter;
+
+    *acc_iter = acc - product_low;
+    // The high half is at most 2^w - 2 whenever the low half is non-zero
+    borrow = static_cast<limb_type>(product >> LIMB_WIDTH) +
+             (acc < product_low ? 1 : 0);
+  }
+
+  return borrow;
+}
+
+BigInt::bit_count_type BigInt::leading_zeros(limb_type limb) {
+  return limb == 0 ? LIMB_WIDTH : __builtin_clzll(limb);
+}
+
+BigInt::limb_type BigInt::divide_by_limb(limbs_type &lhs_limbs,
+                                         limbs_type &quotient, limb_type rhs) {
+  double_limb_type remainder = 0;
+
+  quotient.assign(lhs_limbs.size(), 0);
+
+  for (limbs_index_type index = lhs_limbs.size(); index-- > 0;) {
+    double_limb_type numerator = (remainder << LIMB_WIDTH) | lhs_limbs[index];
+
+    quotient[index] = static_cast<limb_type>(numerator / rhs);
+    remainder = numerator % rhs;
+  }
+
+  return static_cast<limb_type>(remainder);
+}
+
+// Knuth, The Art of Computer Programming Vol. 2, 4.3.1, Algorithm D
+void BigInt::schoolbook_division(limbs_type &lhs_limbs, limbs_type &quotient,
+                                 limbs_const_iter_type rhs_start,
+                                 limbs_const_iter_type rhs_end) {
+  limbs_size_type n = rhs_end - rhs_start;
+  limbs_size_type m = lhs_limbs.size() - n;
+
+  // D1. Normalise so the top bit of the divisor is set, which keeps each
+  // quotient estimate at most two too large
+  bit_count_type shift = leading_zeros(*(rhs_end - 1));
+
+  limbs_type v, u;
+  shift_left(v, rhs_start, rhs_end, shift);
+  v.pop_back();
+  shift_left(u, lhs_limbs.cbegin(), lhs_limbs.cend(), shift);
+
+  limb_type v_top = v[n - 1];
+  limb_type v_next = v[n - 2];
+
+  quotient.assign(m + 1, 0);
+
+  // D2. Loop on j
+  for (limbs_index_type j = m + 1; j-- > 0;) {
+    // D3. Estimate the quotient limb from the top two limbs
+    double_limb_type numerator =
+        (static_cast<double_limb_type>(u[j + n]) << LIMB_WIDTH) | u[j + n - 1];
+
+    double_limb_type q_hat = numerator / v_top;
+    double_limb_type r_hat = numerator % v_top;
+
+    while (q_hat >= LIMB_MODULUS ||
+           q_hat * v_next > ((r_hat << LIMB_WIDTH) | u[j + n - 2])) {
+      --q_hat;
+      r_hat += v_top;
+
+      if (r_hat >= LIMB_MODULUS) {
+        break;
+      }
+    }
+
+    // D4. Multiply and subtract
+    limb_type borrow = subtract_multiply_limbs(u.begin() + j, v.cbegin(),
+                                               v.cend(), q_hat);
+
+    limb_type u_top = u[j + n];
+    u[j + n] = u_top - borrow;
+
+    // D5, D6. The estimate was one too large, so add back
+    if (u_top < borrow) {
+      --q_hat;
+      u[j + n] += add_limbs(u.begin() + j, v.cbegin(), v.cend(), 0);
+    }
+
+    quotient[j] = q_hat;
   }
 
-  while (compare(lhs_limbs.cbegin() + lhs_index, lhs_limbs.cend(), rhs_start,
-                 rhs_end) != Comparison::LESS_THAN) {
-    subtract_big_int(lhs_limbs, lhs_index, rhs_start, rhs_end);
-    ++result;
+  // D8. Unnormalise the remainder
+  shift_right(lhs_limbs, u.cbegin(), u.cbegin() + n, shift);
+}
+
+BigInt BigInt::slice(const BigInt &value, limbs_index_type start,
+                     limbs_size_type count) {
+  BigInt result;
+
+  if (start < value.limbs.size()) {
+    limbs_const_iter_type slice_start = value.limbs.cbegin() + start;
+
+    result.limbs.assign(
+        slice_start,
+        slice_start + std::min(count, value.limbs.size() - start));
+    result.trim();
   }
 
   return result;
 }
 
-BigInt BigInt::long_division(limbs_type &lhs_limbs, limbs_index_type lhs_index,
+// Burnikel and Ziegler, Fast Recursive Division, Algorithm 1
+void BigInt::divide_2n_by_1n(const BigInt &lhs, const BigInt &rhs,
+                             limbs_size_type n, BigInt &quotient,
+                             BigInt &remainder) {
+  if (n % 2 == 1 || n < RECURSIVE_DIVISION_THRESHOLD) {
+    remainder = lhs;
+    quotient = long_division(remainder.limbs, rhs.limbs.cbegin(),
+                             rhs.limbs.cend(), false);
+  } else {
+    limbs_size_type half = n / 2;
+
+    BigInt upper_quotient, upper_remainder;
+    divide_3n_by_2n(slice(lhs, half, 3 * half), rhs, half, upper_quotient,
+                    upper_remainder);
+
+    upper_remainder <<= Limbs(half);
+    upper_remainder += slice(lhs, 0, half);
+
+    divide_3n_by_2n(upper_remainder, rhs, half, quotient, remainder);
+
+    upper_quotient <<= Limbs(half);
+    quotient += upper_quotient;
+  }
+}
+
+// Burnikel and Ziegler, Fast Recursive Division, Algorithm 2
+void BigInt::divide_3n_by_2n(const BigInt &lhs, const BigInt &rhs,
+                             limbs_size_type n, BigInt &quotient,
+                             BigInt &remainder) {
+  BigInt lhs_upper = slice(lhs, n, 2 * n);
+  BigInt rhs_upper = slice(rhs, n, n);
+
+  if (slice(lhs, 2 * n, n) < rhs_upper) {
+    divide_2n_by_1n(lhs_upper, rhs_upper, n, quotient, remainder);
+  } else {
+    // The quotient is β^n - 1, and remainder = lhs_upper - quotient *
+    // rhs_upper, which is never negative here
+    quotient.limbs.assign(n, LIMB_MASK);
+
+    remainder = lhs_upper;
+    remainder += rhs_upper;
+    rhs_upper <<= Limbs(n);
+    remainder -= rhs_upper;
+  }
+
+  BigInt product = quotient * slice(rhs, 0, n);
+
+  remainder <<= Limbs(n);
+  remainder += slice(lhs, 0, n);
+
+  // The estimate is at most two too large
+  while (remainder < product) {
+    remainder += rhs;
+    quotient -= 1;
+  }
+
+  remainder -= product;
+  remainder.trim();
+}
+
+void BigInt::recursive_division(limbs_type &lhs_limbs, limbs_type &quotient,
+                                limbs_const_iter_type rhs_start,
+                                limbs_const_iter_type rhs_end) {
+  limbs_size_type rhs_length = rhs_end - rhs_start;
+
+  // Pick a block size n = j * 2^k no smaller than the divisor, so that every
+  // level of recursion halves evenly down to j limbs
+  limbs_size_type block_count = 1;
+
+  while (rhs_length > block_count * RECURSIVE_DIVISION_THRESHOLD) {
+    block_count *= 2;
+  }
+
+  limbs_size_type n =
+      ((rhs_length + block_count - 1) / block_count) * block_count;
+
+  // Normalise the divisor to exactly n limbs with the top bit set
+  bit_index_type shift =
+      (n - rhs_length) * LIMB_WIDTH + leading_zeros(*(rhs_end - 1));
+
+  BigInt rhs, lhs;
+  rhs.limbs.assign(rhs_start, rhs_end);
+  rhs <<= Bits(shift);
+  lhs.limbs.swap(lhs_limbs);
+  lhs <<= Bits(shift);
+
+  // Split lhs into blocks of n limbs, leaving the top bit of the top block
+  // clear
+  limbs_size_type t = std::max<limbs_size_type>(
+      2, (lhs.log_2() + 1 + n * LIMB_WIDTH - 1) / (n * LIMB_WIDTH));
+
+  BigInt partial = slice(lhs, (t - 2) * n, 2 * n);
+  BigInt block_quotient, remainder;
+
+  quotient.assign((t - 1) * n, 0);
+
+  for (limbs_index_type i = t - 1; i-- > 0;) {
+    divide_2n_by_1n(partial, rhs, n, block_quotient, remainder);
+
+    std::copy(block_quotient.limbs.cbegin(), block_quotient.limbs.cend(),
+              quotient.begin() + i * n);
+
+    if (i > 0) {
+      partial = remainder;
+      partial <<= Limbs(n);
+      partial += slice(lhs, (i - 1) * n, n);
+    }
+  }
+
+  remainder >>= Bits(shift);
+  lhs_limbs.swap(remainder.limbs);
+}
+
+BigInt BigInt::long_division(limbs_type &lhs_limbs,
                              limbs_const_iter_type rhs_start,
-                             limbs_const_iter_type rhs_end) {
+                             limbs_const_iter_type rhs_end,
+                             bool allow_recursion) {
+  rhs_end = significant_end(rhs_start, rhs_end);
+
+  if (rhs_start == rhs_end) {
+    throw domain_error("Divide by zero!");
+  }
+
+  remove_leading_zeros(lhs_limbs);
+
   BigInt result;
 
-  while (true) {
-    result.limbs.push_front(
-        short_division(lhs_limbs, lhs_index, rhs_start, rhs_end));
+  limbs_size_type rhs_length = rhs_end - rhs_start;
 
-    if (lhs_index == 0) {
-      break;
-    } else {
-      --lhs_index;
-    }
+  if (lhs_limbs.size() < rhs_length) {
+    // The quotient is zero and lhs is already the remainder
+  } else if (rhs_length == 1) {
+    limb_type remainder = divide_by_limb(lhs_limbs, result.limbs, *rhs_start);
+
+    lhs_limbs.assign(1, remainder);
+  } else if (allow_recursion && rhs_length >= RECURSIVE_DIVISION_THRESHOLD &&
+             lhs_limbs.size() - rhs_length >= RECURSIVE_DIVISION_THRESHOLD) {
+    recursive_division(lhs_limbs, result.limbs, rhs_start, rhs_end);
+  } else {
+    schoolbook_division(lhs_limbs, result.limbs, rhs_start, rhs_end);
   }
 
+  result.trim();
+  remove_leading_zeros(lhs_limbs);
+
   return result;
 }
 
 void BigInt::div_mod(BigInt &lhs, const BigInt &rhs, BigInt &div) {
-  div = long_division(lhs.limbs, lhs.limbs.size() - 1, rhs.limbs.cbegin(),
-                      rhs.limbs.cend());
+  if (&lhs == &rhs) {
+    BigInt rhs_copy = rhs;
+    return div_mod(lhs, rhs_copy, div);
+  }
+
+  div = long_division(lhs.limbs, rhs.limbs.cbegin(), rhs.limbs.cend());
 }
 
 void BigInt::div_mod(const BigInt &lhs, const BigInt &rhs, BigInt &div,
@@ -379,7 +1174,8 @@ void BigInt::div_mod(const BigInt &lhs, const BigInt &rhs, BigInt &div,
 }
 
 BigInt &BigInt::operator%=(const BigInt &rhs) {
-  long_division(limbs, limbs.size() - 1, rhs.limbs.cbegin(), rhs.limbs.cend());
+  BigInt div;
+  div_mod(*this, rhs, div);
   return *this;
 }
 
@@ -398,28 +1194,99 @@ void BigInt::egcd(long a, long b, long &g, long &x, long &y) {
   }
 }
 
-// https://en.wikibooks.org/wiki/Algorithm_Implementation/Mathematics/Extended_Euclidean_algorithm#Recursive_algorithm_2
-void BigInt::egcd(const BigInt &a, const BigInt &b, const BigInt &b_orig,
-                  BigInt &g, BigInt &x, BigInt &y) {
-  if (a == 0) {
-    g = b;
-    x = BigInt(0);
-    y = BigInt(1);
-  } else {
-    BigInt b_div_a, b_mod_a;
-    div_mod(b, a, b_div_a, b_mod_a);
+void BigInt::shift_right_limbs(limbs_iter_type start, limbs_size_type size,
+                               bit_count_type bits) {
+  if (bits == 0) {
+    return;
+  }
+
+  for (limbs_index_type j = 0; j + 1 < size; ++j) {
+    start[j] = (start[j] >> bits) | (start[j + 1] << (LIMB_WIDTH - bits));
+  }
+
+  start[size - 1] >>= bits;
+}
 
-    BigInt x_prime, y_prime;
-    egcd(b_mod_a, a, b_orig, g, x_prime, y_prime);
+void BigInt::halve_mod(limbs_iter_type x, limbs_const_iter_type n,
+                       limbs_size_type size, limb_type n_neg_inv,
+                       bit_count_type bits) {
+  if (bits == 0) {
+    return;
+  }
+
+  // Add the multiple of n that clears the low bits, as in Montgomery
+  // reduction. (x + m n) / 2^bits < (n + (2^bits - 1) n) / 2^bits = n.
+  limb_type m = (x[0] * n_neg_inv) &
+                ((static_cast<limb_type>(1) << bits) - 1);
+
+  x[size] += multiply_add_limbs(x, n, n + size, m);
+
+  shift_right_limbs(x, size + 1, bits);
+}
+
+// https://en.wikipedia.org/wiki/Binary_GCD_algorithm, keeping the invariants
+// u = x1 b and v = x2 b mod n. Everything is worked in place on fixed-length
+// limbs, and the halvings of x1 and x2 are batched a limb at a time.
+BigInt BigInt::binary_mod_inv(const BigInt &b, const BigInt &n) {
+  limbs_size_type size = n.significant_limb_count();
+  limb_type n_neg_inv = -mod_inv(n.least_significant_limb_value());
 
-    BigInt y_sub = b_div_a * x_prime;
+  BigInt b_mod_n = b;
+  b_mod_n %= n;
 
-    while (y_prime < y_sub) {
-      y_prime += b_orig;
+  if (b_mod_n == 0) {
+    throw invalid_argument("cannot calculate mod inv!");
+  }
+
+  limbs_type mod(size), u(size), x1(size + 1, 0), x2(size + 1, 0);
+  n.copy_limbs(mod.begin(), size);
+  b_mod_n.copy_limbs(u.begin(), size);
+  limbs_type v = mod;
+  x1[0] = 1;
+
+  // Divide value by 2 until it's odd, and its coefficient with it
+  auto make_odd = [&](limbs_type &value, limbs_type &coefficient) {
+    while ((value[0] & 1) == 0) {
+      bit_count_type bits =
+          value[0] == 0 ? LIMB_WIDTH - 1 : __builtin_ctzll(value[0]);
+
+      shift_right_limbs(value.begin(), size, bits);
+      halve_mod(coefficient.begin(), mod.cbegin(), size, n_neg_inv, bits);
     }
+  };
 
-    x = y_prime - y_sub;
-    y = x_prime;
+  // lhs = lhs - rhs mod n
+  auto subtract_mod = [&](limbs_type &lhs, const limbs_type &rhs) {
+    if (subtract_limbs(lhs.begin(), rhs.cbegin(), rhs.cbegin() + size, 0)) {
+      add_limbs(lhs.begin(), mod.cbegin(), mod.cend(), 0);
+    }
+  };
+
+  make_odd(u, x1);
+
+  // Both are odd, so the larger minus the smaller is even and gets at least
+  // one bit shorter, until they meet at gcd(b, n)
+  for (;;) {
+    switch (compare(u.cbegin(), u.cend(), v.cbegin(), v.cend())) {
+    case Comparison::GREATER_THAN:
+      subtract_limbs(u.begin(), v.cbegin(), v.cend(), 0);
+      subtract_mod(x1, x2);
+      make_odd(u, x1);
+      break;
+    case Comparison::LESS_THAN:
+      subtract_limbs(v.begin(), u.cbegin(), u.cend(), 0);
+      subtract_mod(x2, x1);
+      make_odd(v, x2);
+      break;
+    default:
+      if (compare(u.cbegin(), u.cend(), 1) != Comparison::EQUALS) {
+        throw invalid_argument("cannot calculate mod inv!");
+      }
+
+      BigInt inverse;
+      inverse.assign(x1.cbegin(), x1.cbegin() + size);
+      return inverse;
+    }
   }
 }
 
@@ -433,82 +1300,170 @@ long BigInt::mod_inv(long b, long n) {
   }
 }
 
+// Newton's iteration, each step doubles the number of correct low bits
+BigInt::limb_type BigInt::mod_inv(limb_type b) {
+  if ((b & 1) == 0) {
+    throw invalid_argument("cannot calculate mod inv!");
+  }
+
+  // Correct to 3 bits, as b * b = 1 mod 8 for all odd b
+  limb_type x = b;
+
+  for (bit_count_type bits = 3; bits < LIMB_WIDTH; bits *= 2) {
+    x *= 2 - b * x;
+  }
+
+  return x;
+}
+
 BigInt BigInt::mod_inv(const BigInt &b, const BigInt &n) {
-  BigInt g, x, y;
-  egcd(b, n, n, g, x, y);
-  if (g == 1) {
-    return x;
-  } else {
+  if (n.least_significant_limb_value() & 1) {
+    return binary_mod_inv(b, n);
+  }
+
+  BigInt b_mod_n = b;
+  b_mod_n %= n;
+
+  // An even n needs an odd b, and then n y = 1 + b k for y = n^-1 mod b, so
+  // b (n - k) = 1 mod n
+  if ((b_mod_n.least_significant_limb_value() & 1) == 0) {
     throw invalid_argument("cannot calculate mod inv!");
+  } else if (b_mod_n == 1) {
+    return b_mod_n;
   }
+
+  BigInt k = n * binary_mod_inv(n, b_mod_n);
+  k -= 1;
+
+  // k is left holding the remainder, which is 0
+  BigInt quotient;
+  div_mod(k, b_mod_n, quotient);
+
+  return n - quotient;
 }
 
 BigInt::bit_index_type BigInt::log_2() const {
-  return limb_count() * LIMB_WIDTH;
+  limbs_const_iter_type end = significant_end(limbs.cbegin(), limbs.cend());
+
+  if (end == limbs.cbegin()) {
+    return 0;
+  }
+
+  return (end - limbs.cbegin()) * LIMB_WIDTH - leading_zeros(*(end - 1));
 }
 
-int BigInt::operator[](const BigInt::bit_index_type index) const {
-  if (index < 0) {
+BigInt::limb_type BigInt::window(bit_index_type position,
+                                 bit_count_type width) const {
+  if (position < 0) {
     throw range_error("Cannot access negative bit");
-  } else {
-    limbs_index_type limb_index = index / LIMB_WIDTH;
-    bit_index_type bit_index = index % LIMB_WIDTH;
+  } else if (width > LIMB_WIDTH) {
+    throw range_error("Window is wider than a limb");
+  }
 
-    if (limb_index >= limb_count()) {
-      return 0;
-    } else {
-      return (limbs[limb_index] >> bit_index) & 1;
-    }
+  limbs_index_type limb_index = position / LIMB_WIDTH;
+  bit_count_type shift = position % LIMB_WIDTH;
+
+  if (limb_index >= limbs.size() || width == 0) {
+    return 0;
+  }
+
+  limb_type bits = limbs[limb_index] >> shift;
+
+  // The window straddles into the next limb
+  if (shift + width > LIMB_WIDTH && limb_index + 1 < limbs.size()) {
+    bits |= limbs[limb_index + 1] << (LIMB_WIDTH - shift);
   }
+
+  return width == LIMB_WIDTH ? bits
+                             : bits & ((static_cast<limb_type>(1) << width) - 1);
+}
+
+int BigInt::operator[](const BigInt::bit_index_type index) const {
+  return static_cast<int>(window(index, 1));
 }
 
 BigInt &operator<<=(BigInt &lhs, const BigInt::Limbs &rhs) {
-  for (unsigned int n = 0; n < rhs.quantity; ++n) {
-    lhs.limbs.push_front(0);
-  }
+  lhs.limbs.insert(lhs.limbs.begin(), rhs.quantity, 0);
 
   return lhs;
 }
 
 BigInt &operator>>=(BigInt &lhs, const BigInt::Limbs &rhs) {
-  for (unsigned int n = 0; n < rhs.quantity; ++n) {
-    lhs.limbs.pop_front();
+  lhs.limbs.erase(lhs.limbs.begin(),
+                  lhs.limbs.begin() +
+                      std::min<BigInt::limbs_size_type>(rhs.quantity,
+                                                        lhs.limbs.size()));
+
+  return lhs;
+}
+
+BigInt &operator<<=(BigInt &lhs, const BigInt::Bits &rhs) {
+  lhs <<= BigInt::Limbs(rhs.quantity / BigInt::LIMB_WIDTH);
+
+  BigInt::bit_count_type bits = rhs.quantity % BigInt::LIMB_WIDTH;
+
+  if (bits > 0) {
+    BigInt::shift_left(lhs.limbs, lhs.limbs.cbegin(), lhs.limbs.cend(), bits);
+    lhs.trim();
+  }
+
+  return lhs;
+}
+
+BigInt &operator>>=(BigInt &lhs, const BigInt::Bits &rhs) {
+  lhs >>= BigInt::Limbs(rhs.quantity / BigInt::LIMB_WIDTH);
+
+  BigInt::bit_count_type bits = rhs.quantity % BigInt::LIMB_WIDTH;
+
+  if (bits > 0) {
+    BigInt::shift_right(lhs.limbs, lhs.limbs.cbegin(), lhs.limbs.cend(), bits);
+    lhs.trim();
   }
 
   return lhs;
 }
 
 istream &operator>>(istream &is, BigInt &value) {
-  string value_str;
+  // assign_hex wants the whole token in memory. Per thread, as the pipeline
+  // reads on one thread while workers may format on others.
+  thread_local string buffer;
+  buffer.clear();
 
-  is >> value_str;
+  is >> buffer;
 
-  value = BigInt(value_str);
+  value.assign_hex(buffer.data(), buffer.data() + buffer.length());
 
   return is;
 }
 
 ostream &operator<<(ostream &os, const BigInt &value) {
+  BigInt::limbs_const_iter_type end =
+      BigInt::significant_end(value.limbs.cbegin(), value.limbs.cend());
 
-  if (!value.limbs.empty()) {
-    ios::fmtflags f(os.flags());
+  if (end == value.limbs.cbegin()) {
+    return os << "0";
+  }
 
-    os << std::hex;
-    os << std::uppercase;
+  // Formatting into a buffer first means the stream sees a single write
+  // rather than one per digit
+  thread_local std::vector<char> buffer;
+  buffer.resize((end - value.limbs.cbegin()) * BigInt::HEX_CHARS_PER_LIMB);
 
-    os << value.limbs.back();
+  char *out = buffer.data();
 
-    for (auto iter = value.limbs.crbegin() + 1; iter != value.limbs.crend();
-         ++iter) {
-      os << std::setfill('0') << std::setw(BigInt::HEX_CHARS_PER_LIMB) << *iter;
-    }
+  for (auto iter = BigInt::limbs_const_reverse_iter_type(end);
+       iter != value.limbs.crend(); ++iter) {
+    out = BigInt::format_limb(*iter, out);
+  }
 
-    os.flags(f);
-  } else {
-    os << "0";
+  // Skip the leading zeros of the most significant limb
+  const char *start = buffer.data();
+
+  while (*start == '0') {
+    ++start;
   }
 
-  return os;
+  return os.write(start, out - start);
 }
 
 BigInt::limbs_size_type BigInt::limb_count() const { return limbs.size(); }
@@ -1,13 +1,15 @@
 #pragma once
 
+#include <algorithm>
 #include <climits>
 #include <cstddef>
 #include <cstdint>
-#include <deque>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 //#include "list.hpp"
 
@@ -31,10 +33,11 @@ public:
   };
 
   typedef uint8_t bit_count_type;
-  typedef uint16_t limb_type;
-  typedef uint32_t double_limb_type;
-  typedef std::deque<limb_type> limbs_type;
+  typedef uint64_t limb_type;
+  typedef unsigned __int128 double_limb_type;
+  typedef std::vector<limb_type> limbs_type;
   typedef limbs_type::size_type limbs_index_type;
+  typedef limbs_type::iterator limbs_iter_type;
   typedef limbs_type::const_iterator limbs_const_iter_type;
   typedef limbs_type::const_reverse_iterator limbs_const_reverse_iter_type;
   typedef limbs_type::difference_type limbs_index_difference_type;
@@ -43,27 +46,59 @@ public:
 
   static const bit_count_type HEX_BITS = 4;
   static const size_t HEX_MODULUS = 1 << BigInt::HEX_BITS;
-  static const bit_count_type LIMB_WIDTH = 16;
-  static const double_limb_type LIMB_MODULUS = 1 << BigInt::LIMB_WIDTH;
+  static const bit_count_type LIMB_WIDTH = 64;
+  static const double_limb_type LIMB_MODULUS = static_cast<double_limb_type>(1)
+                                               << BigInt::LIMB_WIDTH;
   static const double_limb_type LIMB_MASK = BigInt::LIMB_MODULUS - 1;
   static const bit_count_type HEX_CHARS_PER_LIMB = LIMB_WIDTH / HEX_BITS;
 
+  // Divisors of at least this many limbs use recursive division
+  static const limbs_size_type RECURSIVE_DIVISION_THRESHOLD = 80;
+
+  class Bits {
+  public:
+    const bit_index_type quantity;
+
+    Bits(const bit_index_type quantity);
+  };
+
 private:
+  // The value of each hex digit character, or -1 for any other character
+  static const int8_t HEX_DIGIT_VALUES[UCHAR_MAX + 1];
+  // The two hex digits of each byte value, most significant first
+  static const char HEX_DIGIT_PAIRS[];
+
   limbs_type limbs;
 
+  // Parse at most HEX_CHARS_PER_LIMB hex digits
+  static limb_type parse_limb(const char *start, const char *end);
+  // Write exactly HEX_CHARS_PER_LIMB hex digits, returning the end
+  static char *format_limb(limb_type limb, char *out);
+
   // Add a leading zero if the iterator is off the end
   static void maybe_add_leading_zero(limbs_type &limbs, limbs_index_type index);
 
   // Remove leading zeros
   static void remove_leading_zeros(limbs_type &limbs);
 
-  // Split a double limb into two limbs
-  static void split_double_limb(double_limb_type d, double_limb_type &large,
-                                limb_type &small);
+  // Move end backwards until it is just past a non-zero limb, or reaches start
+  static limbs_const_iter_type significant_end(limbs_const_iter_type start,
+                                               limbs_const_iter_type end);
+
+  // result = (start..end) << bits, where bits < LIMB_WIDTH
+  static void shift_left(limbs_type &result, limbs_const_iter_type start,
+                         limbs_const_iter_type end, bit_count_type bits);
 
-  // Move lhs_iter backwards until it reaches lhs_start of a non-zero limb
-  static limbs_const_iter_type first_non_zero(limbs_const_iter_type start,
-                                              limbs_const_iter_type end);
+  // result = (start..end) >> bits, where bits < LIMB_WIDTH
+  static void shift_right(limbs_type &result, limbs_const_iter_type start,
+                          limbs_const_iter_type end, bit_count_type bits);
+
+  // The number of zero bits above the highest set bit
+  static bit_count_type leading_zeros(limb_type limb);
+
+  // The limbs [start, start + count) of value
+  static BigInt slice(const BigInt &value, limbs_index_type start,
+                      limbs_size_type count);
 
   enum class Comparison { LESS_THAN = -1, EQUALS = 0, GREATER_THAN = 1 };
 
@@ -85,6 +120,23 @@ private:
                             limbs_const_iter_type rhs_start,
                             limbs_const_iter_type rhs_end);
 
+  // acc += rhs + carry over the length of rhs, returning the carry out
+  static limb_type add_limbs(limbs_iter_type acc_iter,
+                             limbs_const_iter_type rhs_iter,
+                             limbs_const_iter_type rhs_end, limb_type carry);
+
+  // acc -= rhs + borrow over the length of rhs, returning the borrow out
+  static limb_type subtract_limbs(limbs_iter_type acc_iter,
+                                  limbs_const_iter_type rhs_iter,
+                                  limbs_const_iter_type rhs_end,
+                                  limb_type borrow);
+
+  // acc += lhs * rhs over the length of lhs, returning the carry limb
+  static limb_type multiply_add_limbs(limbs_iter_type acc_iter,
+                                      limbs_const_iter_type lhs_iter,
+                                      limbs_const_iter_type lhs_end,
+                                      limb_type rhs);
+
   // lhs += rhs
   static void add_limb(limbs_type &lhs_limbs, limbs_index_type lhs_index,
                        double_limb_type rhs);
@@ -112,24 +164,219 @@ private:
                                   limbs_const_iter_type rhs_iter,
                                   limbs_const_iter_type rhs_end);
 
-  static limb_type short_division(limbs_type &lhs_limbs,
-                                  limbs_index_type lhs_index,
+  // acc -= lhs * rhs over the length of lhs, returning the borrow limb
+  static limb_type subtract_multiply_limbs(limbs_iter_type acc_iter,
+                                           limbs_const_iter_type lhs_iter,
+                                           limbs_const_iter_type lhs_end,
+                                           limb_type rhs);
+
+  // quotient = lhs / rhs, returning the remainder
+  static limb_type divide_by_limb(limbs_type &lhs_limbs, limbs_type &quotient,
+                                  limb_type rhs);
+
+  // quotient = lhs / rhs, lhs = lhs % rhs, where rhs has at least two limbs
+  // and a non-zero most significant limb
+  static void schoolbook_division(limbs_type &lhs_limbs, limbs_type &quotient,
                                   limbs_const_iter_type rhs_start,
                                   limbs_const_iter_type rhs_end);
 
-  static BigInt long_division(limbs_type &lhs_limbs, limbs_index_type lhs_index,
+  // lhs * rhs, choosing the algorithm from the size of the operands
+  static BigInt multiply(const BigInt &lhs, const BigInt &rhs);
+
+  // lhs * rhs, splitting both operands into two parts of m limbs
+  static BigInt karatsuba_multiply(const BigInt &lhs, const BigInt &rhs,
+                                   limbs_size_type m);
+
+  // acc = (start..end)^2, computing each cross product once
+  static void square_limbs(limbs_type &acc_limbs, limbs_const_iter_type start,
+                           limbs_const_iter_type end);
+
+  // value^2, splitting value into two parts of m limbs
+  static BigInt karatsuba_square(const BigInt &value, limbs_size_type m);
+
+  // lhs * rhs, splitting both operands into three parts of k limbs
+  static BigInt toom_3_multiply(const BigInt &lhs, const BigInt &rhs,
+                                limbs_size_type k);
+
+  // Divide a 2n limb lhs by a normalised n limb rhs
+  static void divide_2n_by_1n(const BigInt &lhs, const BigInt &rhs,
+                              limbs_size_type n, BigInt &quotient,
+                              BigInt &remainder);
+
+  // Divide a 3n limb lhs by a normalised 2n limb rhs
+  static void divide_3n_by_2n(const BigInt &lhs, const BigInt &rhs,
+                              limbs_size_type n, BigInt &quotient,
+                              BigInt &remainder);
+
+  // As schoolbook_division, but in subquadratic time for large operands
+  static void recursive_division(limbs_type &lhs_limbs, limbs_type &quotient,
+                                 limbs_const_iter_type rhs_start,
+                                 limbs_const_iter_type rhs_end);
+
+  // Returns lhs / rhs, leaving lhs % rhs in lhs
+  static BigInt long_division(limbs_type &lhs_limbs,
                               limbs_const_iter_type rhs_start,
-                              limbs_const_iter_type rhs_end);
+                              limbs_const_iter_type rhs_end,
+                              bool allow_recursion = true);
+
+  // result = t / β^n mod mod, where t has 2n + 1 limbs, t < mod β^n and
+  // result doesn't overlap the top n + 1 limbs of t, which is overwritten
+  static void montgomery_reduce_fixed(limbs_iter_type result,
+                                      limbs_iter_type t,
+                                      limbs_const_iter_type mod,
+                                      limbs_size_type n,
+                                      limb_type mod_neg_inv);
 
   static void egcd(long a, long b, long &g, long &x, long &y);
-  static void egcd(const BigInt &a, const BigInt &b, const BigInt &b_orig,
-                   BigInt &g, BigInt &x, BigInt &y);
+
+  // (start..start + size) >>= bits in place, where bits < LIMB_WIDTH
+  static void shift_right_limbs(limbs_iter_type start, limbs_size_type size,
+                                bit_count_type bits);
+
+  // x = x / 2^bits mod n, where n is odd with size limbs, x < n has size + 1
+  // limbs, n_neg_inv = -n^-1 mod β and bits < LIMB_WIDTH
+  static void halve_mod(limbs_iter_type x, limbs_const_iter_type n,
+                        limbs_size_type size, limb_type n_neg_inv,
+                        bit_count_type bits);
+
+  // The inverse of b mod an odd n, by the binary extended GCD
+  static BigInt binary_mod_inv(const BigInt &b, const BigInt &n);
+
+  // The bodies of the fixed-length kernels, templated on the type of the limb
+  // count. BigInt passes the count at run time, and FixedBigInt passes an
+  // std::integral_constant, whose loops then have a constant trip count the
+  // compiler can unroll.
+
+  // acc += (lhs..lhs + count) * rhs, returning the carry out of the top
+  template <typename AccIter, typename LhsIter, typename Count>
+  static limb_type multiply_add_n(AccIter acc, LhsIter lhs, Count count,
+                                  limb_type rhs) {
+    const limbs_size_type n = count;
+    limb_type carry = 0;
+
+    for (limbs_index_type j = 0; j < n; ++j) {
+      // At most (2^w - 1)^2 + 2(2^w - 1) = 2^2w - 1, so this cannot overflow
+      double_limb_type product =
+          static_cast<double_limb_type>(lhs[j]) * rhs + acc[j] + carry;
+
+      acc[j] = static_cast<limb_type>(product);
+      carry = static_cast<limb_type>(product >> LIMB_WIDTH);
+    }
+
+    return carry;
+  }
+
+  // acc = (value..value + count)^2, where acc is 2 count zeroed limbs
+  template <typename AccIter, typename ValueIter, typename Count>
+  static void square_n(AccIter acc, ValueIter value, Count count) {
+    const limbs_size_type n = count;
+
+    // Each cross product a_i a_j with i < j, once
+    for (limbs_index_type i = 0; i + 1 < n; ++i) {
+      acc[i + n] = multiply_add_n(acc + 2 * i + 1, value + i + 1, n - i - 1,
+                                  value[i]);
+    }
+
+    // Double the cross products and add the squares a_i^2 in a single pass
+    limb_type shifted_out = 0;
+    limb_type carry = 0;
+
+    for (limbs_index_type i = 0; i < n; ++i) {
+      double_limb_type square =
+          static_cast<double_limb_type>(value[i]) * value[i];
+
+      for (limbs_index_type j = 2 * i; j < 2 * i + 2; ++j) {
+        limb_type doubled = (acc[j] << 1) | shifted_out;
+        shifted_out = acc[j] >> (LIMB_WIDTH - 1);
+
+        double_limb_type sum = static_cast<double_limb_type>(doubled) +
+                               static_cast<limb_type>(square) + carry;
+
+        acc[j] = static_cast<limb_type>(sum);
+        carry = static_cast<limb_type>(sum >> LIMB_WIDTH);
+        square >>= LIMB_WIDTH;
+      }
+    }
+  }
+
+  // subtract_if_not_less, over count limbs
+  template <typename ResultIter, typename TIter, typename Count>
+  static void subtract_if_not_less_n(ResultIter result, TIter t,
+                                     limbs_const_iter_type mod, Count count) {
+    const limbs_size_type n = count;
+    limb_type borrow = 0;
+
+    for (limbs_index_type j = 0; j < n; ++j) {
+      limb_type t_limb = t[j];
+      limb_type difference = t_limb - mod[j] - borrow;
+
+      borrow = (t_limb < mod[j]) | ((t_limb == mod[j]) & borrow);
+      result[j] = difference;
+    }
+
+    // t < mod exactly when the subtraction borrows out of the top limb
+    limb_type keep_mask = 0 - (borrow & (t[n] ^ 1));
+
+    for (limbs_index_type j = 0; j < n; ++j) {
+      result[j] = (t[j] & keep_mask) | (result[j] & ~keep_mask);
+    }
+  }
+
+  // montgomery_reduce_fixed, over count limbs
+  template <typename ResultIter, typename TIter, typename Count>
+  static void montgomery_reduce_n(ResultIter result, TIter t,
+                                  limbs_const_iter_type mod, Count count,
+                                  limb_type mod_neg_inv) {
+    const limbs_size_type n = count;
+
+    // The carry out of limb i + n, added in at the next step rather than
+    // rippled up now, so the work doesn't depend on the value
+    limb_type top_carry = 0;
+
+    for (limbs_index_type i = 0; i < n; ++i) {
+      // Add a multiple of mod that makes limb i zero
+      limb_type carry = multiply_add_n(t + i, mod, count, t[i] * mod_neg_inv);
+
+      double_limb_type sum =
+          static_cast<double_limb_type>(t[i + n]) + carry + top_carry;
+
+      t[i + n] = static_cast<limb_type>(sum);
+      top_carry = static_cast<limb_type>(sum >> LIMB_WIDTH);
+    }
+
+    t[2 * n] = top_carry;
+
+    // Divide by β^n, then bring t < 2 mod below mod
+    subtract_if_not_less_n(result, t + n, mod, count);
+  }
+
+  template <limbs_size_type Bits> friend class FixedBigInt;
 
 public:
+  // Operands with at least this many limbs use Karatsuba multiplication, see
+  // bench/multiply.cpp
+  static limbs_size_type karatsuba_threshold;
+  // Operands with at least this many limbs use Toom-3 multiplication
+  static limbs_size_type toom_3_threshold;
+
   BigInt() = default;
   BigInt(uint64_t n);
   BigInt(const string &str);
 
+  // Set the value from a string of hex digits, most significant first
+  void assign_hex(const char *start, const char *end);
+
+  // Set the value from count little-endian limbs, least significant first
+  void assign_limbs(const char *start, limbs_size_type count);
+  // Store the significant limbs in the same form, returning the end
+  char *store_limbs(char *out) const;
+  limbs_size_type significant_limb_count() const;
+
+  // Set the value from the limbs (start..end), reusing the existing storage
+  void assign(limbs_const_iter_type start, limbs_const_iter_type end);
+  // Write the value as exactly n limbs, padding with leading zeros
+  void copy_limbs(limbs_iter_type out, limbs_size_type n) const;
+
   // Add a limb as the most significant limb
   void append_limb(string limb_str);
   void append_limb(unsigned long int limb);
@@ -155,21 +402,81 @@ public:
   BigInt operator*(limb_type rhs) const;
   BigInt operator*(const BigInt &rhs) const;
 
+  // *this * *this, but faster
+  BigInt square() const;
+
   static void div_mod(BigInt &lhs, const BigInt &rhs, BigInt &div);
   static void div_mod(const BigInt &lhs, const BigInt &rhs, BigInt &div,
                       BigInt &mod);
 
   BigInt &operator%=(const BigInt &rhs);
 
+  // result = lhs * rhs / β^n mod mod, where mod has n limbs, lhs, rhs < mod,
+  // mod_neg_inv = -mod^-1 mod β, and β = LIMB_MODULUS
+  static void montgomery_multiply(BigInt &result, const BigInt &lhs,
+                                  const BigInt &rhs, const BigInt &mod,
+                                  limb_type mod_neg_inv);
+
+  // value = value / β^n mod mod, where mod has n limbs and
+  // mod_neg_inv = -mod^-1 mod β
+  static void montgomery_reduce(BigInt &value, const BigInt &mod,
+                                limb_type mod_neg_inv);
+
+  // The kernels below work on exactly n limbs of caller provided storage,
+  // never branching on or indexing memory by the values of their operands
+
+  // result = t < mod ? t : t - mod, where t has n + 1 limbs, t < 2 mod and
+  // result doesn't overlap t
+  static void subtract_if_not_less(limbs_iter_type result,
+                                   limbs_const_iter_type t,
+                                   limbs_const_iter_type mod,
+                                   limbs_size_type n);
+
+  // result = lhs * rhs / β^n mod mod, using t as n + 2 limbs of scratch.
+  // result may alias lhs or rhs.
+  static void montgomery_multiply_fixed(limbs_iter_type result,
+                                        limbs_const_iter_type lhs,
+                                        limbs_const_iter_type rhs,
+                                        limbs_const_iter_type mod,
+                                        limbs_size_type n,
+                                        limb_type mod_neg_inv,
+                                        limbs_iter_type t);
+
+  // result = value^2 / β^n mod mod, using t as scratch, which only
+  // reallocates below a capacity of 2n + 1 limbs
+  static void montgomery_square_fixed(limbs_iter_type result,
+                                      limbs_const_iter_type value,
+                                      limbs_const_iter_type mod,
+                                      limbs_size_type n,
+                                      limb_type mod_neg_inv, limbs_type &t);
+
+  // result = entry index of a table of count entries, reading every entry
+  static void select_limbs(limbs_iter_type result,
+                           limbs_const_iter_type table, limbs_size_type n,
+                           limbs_size_type count, limb_type index);
+
+  // The width bits of (limbs..) starting at bit position, where width <=
+  // LIMB_WIDTH and the limb after the one holding position can be read
+  static limb_type window_limbs(limbs_const_iter_type limbs,
+                                bit_index_type position, bit_count_type width);
+
   static long mod_inv(long b, long n);
+  // The inverse of an odd b mod LIMB_MODULUS
+  static limb_type mod_inv(limb_type b);
   static BigInt mod_inv(const BigInt &b, const BigInt &n);
 
+  // The number of significant bits, which is 0 for 0
   bit_index_type log_2() const;
+  // The width bits starting at bit position, where width <= LIMB_WIDTH
+  limb_type window(bit_index_type position, bit_count_type width) const;
   int operator[](const bit_index_type index) const;
 
   friend BigInt &operator<<=(BigInt &lhs, const Limbs &rhs);
   friend BigInt &operator>>=(BigInt &lhs, const Limbs &rhs);
 
+  friend BigInt &operator<<=(BigInt &lhs, const Bits &rhs);
+  friend BigInt &operator>>=(BigInt &lhs, const Bits &rhs);
+
   friend istream &operator>>(istream &is, BigInt &value);
   friend ostream &operator<<(ostream &os, const BigInt &value);
 
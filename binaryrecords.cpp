@@ -0,0 +1,87 @@
+#include "binaryrecords.hpp"
+
+const char BinaryRecords::MAGIC[4] = {'M', 'M', 'R', '1'};
+
+void BinaryRecords::write_field(ostream &out, field_type field) {
+  char bytes[sizeof(field_type)];
+
+  for (char &byte : bytes) {
+    byte = static_cast<char>(field & UCHAR_MAX);
+    field >>= CHAR_BIT;
+  }
+
+  out.write(bytes, sizeof(bytes));
+}
+
+bool BinaryRecords::read_field(RecordInput &in, field_type &field) {
+  const char *bytes;
+
+  if (!in.next_bytes(sizeof(field_type), bytes)) {
+    return false;
+  }
+
+  field = 0;
+
+  for (size_t byte = sizeof(field_type); byte > 0; --byte) {
+    field = (field << CHAR_BIT) | static_cast<unsigned char>(bytes[byte - 1]);
+  }
+
+  return true;
+}
+
+void BinaryRecords::write_header(ostream &out, field_type stage,
+                                 field_type arity) {
+  out.write(MAGIC, sizeof(MAGIC));
+  write_field(out, stage);
+  write_field(out, arity);
+}
+
+void BinaryRecords::read_header(RecordInput &in, field_type &stage,
+                                field_type &arity) {
+  const char *magic;
+
+  if (!in.next_bytes(sizeof(MAGIC), magic) ||
+      memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+    throw invalid_argument("input is not in the binary record format");
+  }
+
+  if (!read_field(in, stage) || !read_field(in, arity)) {
+    throw invalid_argument("binary record header is truncated");
+  }
+}
+
+void BinaryRecords::write_value(ostream &out, const BigInt &value) {
+  // The limbs are laid out little-endian here so the value goes out in one
+  // write. The buffer keeps its capacity for the next value on this thread.
+  thread_local std::vector<char> buffer;
+
+  BigInt::limbs_size_type count = value.significant_limb_count();
+  buffer.resize(count * sizeof(BigInt::limb_type));
+
+  value.store_limbs(buffer.data());
+
+  write_field(out, static_cast<field_type>(count));
+  out.write(buffer.data(), buffer.size());
+}
+
+bool BinaryRecords::read_value(RecordInput &in, BigInt &value) {
+  field_type count;
+
+  if (!read_field(in, count)) {
+    return false;
+  }
+
+  if (count > MAX_VALUE_LIMBS) {
+    throw invalid_argument("binary record value is too large");
+  }
+
+  const char *limbs;
+
+  if (!in.next_bytes(count * sizeof(BigInt::limb_type), limbs)) {
+    throw invalid_argument("binary record value is truncated");
+  }
+
+  value.assign_limbs(limbs, count);
+
+  return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "bigint.hpp"
+#include "recordinput.hpp"
+
+using std::invalid_argument;
+using std::ostream;
+
+/*
+Reads and writes records in a binary format, as an alternative to lines of
+hex. All integers are little-endian.
+
+- The header is MAGIC, then the stage tag and the record arity, as 32-bit
+  fields.
+- Each value is its limb count as a 32-bit field, followed by that many
+  64-bit limbs, least significant first.
+*/
+class BinaryRecords {
+public:
+  typedef uint32_t field_type;
+
+  static const char MAGIC[4];
+
+  // The most limbs a value may have, 65536 bits, well beyond any key the
+  // stages use. Larger counts are rejected before anything is read, so a
+  // corrupt count can't make the input buffer grow without bound.
+  static const field_type MAX_VALUE_LIMBS = 1024;
+
+private:
+  static void write_field(ostream &out, field_type field);
+  static bool read_field(RecordInput &in, field_type &field);
+
+public:
+  static void write_header(ostream &out, field_type stage, field_type arity);
+
+  // Throws invalid_argument if the input doesn't start with a header
+  static void read_header(RecordInput &in, field_type &stage,
+                          field_type &arity);
+
+  static void write_value(ostream &out, const BigInt &value);
+
+  // Read a value into value's limbs, returning false at the end of the input.
+  // Throws invalid_argument if the value is truncated or has more than
+  // MAX_VALUE_LIMBS limbs.
+  static bool read_value(RecordInput &in, BigInt &value);
+};
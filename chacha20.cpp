@@ -0,0 +1,135 @@
+#include "chacha20.hpp"
+
+ChaCha20::key_type ChaCha20::seed_key = {};
+std::atomic<unsigned long> ChaCha20::seed_generation(0);
+uint64_t ChaCha20::next_stream = 0;
+std::mutex ChaCha20::seed_mutex;
+
+ChaCha20::ChaCha20() : key(), stream(0), counter(0), buffered(0) {}
+
+// https://datatracker.ietf.org/doc/html/rfc8439#section-2.1
+void ChaCha20::quarter_round(blocks_type &x, size_t a, size_t b, size_t c,
+                             size_t d) {
+  for (size_t block = 0; block < PARALLEL_BLOCKS; ++block) {
+    x[a][block] += x[b][block];
+    x[d][block] ^= x[a][block];
+    x[d][block] = (x[d][block] << 16) | (x[d][block] >> 16);
+
+    x[c][block] += x[d][block];
+    x[b][block] ^= x[c][block];
+    x[b][block] = (x[b][block] << 12) | (x[b][block] >> 20);
+
+    x[a][block] += x[b][block];
+    x[d][block] ^= x[a][block];
+    x[d][block] = (x[d][block] << 8) | (x[d][block] >> 24);
+
+    x[c][block] += x[d][block];
+    x[b][block] ^= x[c][block];
+    x[b][block] = (x[b][block] << 7) | (x[b][block] >> 25);
+  }
+}
+
+// https://datatracker.ietf.org/doc/html/rfc8439#section-2.3
+void ChaCha20::refill() {
+  // "expand 32-byte k"
+  const uint32_t constants[4] = {0x61707865, 0x3320646e, 0x79622d32,
+                                 0x6b206574};
+
+  blocks_type input, x;
+
+  for (size_t block = 0; block < PARALLEL_BLOCKS; ++block) {
+    uint64_t block_counter = counter + block;
+
+    for (size_t word = 0; word < 4; ++word) {
+      input[word][block] = constants[word];
+    }
+
+    for (size_t word = 0; word < KEY_WORDS; ++word) {
+      input[word + 4][block] = key[word];
+    }
+
+    input[12][block] = static_cast<uint32_t>(block_counter);
+    input[13][block] = static_cast<uint32_t>(block_counter >> 32);
+    input[14][block] = static_cast<uint32_t>(stream);
+    input[15][block] = static_cast<uint32_t>(stream >> 32);
+  }
+
+  std::copy(&input[0][0], &input[0][0] + BLOCK_WORDS * PARALLEL_BLOCKS,
+            &x[0][0]);
+
+  for (size_t round = 0; round < DOUBLE_ROUNDS; ++round) {
+    // Columns
+    quarter_round(x, 0, 4, 8, 12);
+    quarter_round(x, 1, 5, 9, 13);
+    quarter_round(x, 2, 6, 10, 14);
+    quarter_round(x, 3, 7, 11, 15);
+
+    // Diagonals
+    quarter_round(x, 0, 5, 10, 15);
+    quarter_round(x, 1, 6, 11, 12);
+    quarter_round(x, 2, 7, 8, 13);
+    quarter_round(x, 3, 4, 9, 14);
+  }
+
+  // Each block's words in order, two to a limb
+  for (size_t block = 0; block < PARALLEL_BLOCKS; ++block) {
+    for (size_t word = 0; word < BLOCK_WORDS; word += 2) {
+      uint32_t low = x[word][block] + input[word][block],
+               high = x[word + 1][block] + input[word + 1][block];
+
+      buffer[(block * BLOCK_WORDS + word) / 2] =
+          (static_cast<BigInt::limb_type>(high) << 32) | low;
+    }
+  }
+
+  counter += PARALLEL_BLOCKS;
+  buffered = BUFFER_LIMBS;
+}
+
+void ChaCha20::rekey(const key_type &new_key, uint64_t new_stream) {
+  std::copy(new_key, new_key + KEY_WORDS, key);
+  stream = new_stream;
+  counter = 0;
+  buffered = 0;
+}
+
+void ChaCha20::fill(BigInt::limb_type *out, size_t count) {
+  while (count > 0) {
+    if (buffered == 0) {
+      refill();
+    }
+
+    size_t taken = std::min(count, buffered);
+    const BigInt::limb_type *start = buffer + BUFFER_LIMBS - buffered;
+
+    std::copy(start, start + taken, out);
+
+    out += taken;
+    count -= taken;
+    buffered -= taken;
+  }
+}
+
+void ChaCha20::seed(const key_type &key) {
+  std::lock_guard<std::mutex> lock(seed_mutex);
+
+  std::copy(key, key + KEY_WORDS, seed_key);
+  next_stream = 0;
+
+  ++seed_generation;
+}
+
+ChaCha20 &ChaCha20::local() {
+  static thread_local ChaCha20 generator;
+  // Never equal to seed_generation, so the first call keys the generator
+  static thread_local unsigned long generation = ~0ul;
+
+  if (generation != seed_generation.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(seed_mutex);
+
+    generator.rekey(seed_key, next_stream++);
+    generation = seed_generation;
+  }
+
+  return generator;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "bigint.hpp"
+
+// The ChaCha20 stream cipher's keystream as a random number generator, with
+// a 64-bit block counter and a 64-bit stream number in place of the nonce.
+// Every thread has its own generator, keyed with the shared seed on a stream
+// of its own, so threads never contend or repeat each other's output.
+class ChaCha20 {
+public:
+  static const size_t KEY_WORDS = 8;
+
+  typedef uint32_t key_type[KEY_WORDS];
+
+private:
+  static const size_t BLOCK_WORDS = 16;
+  static const size_t DOUBLE_ROUNDS = 10;
+
+  // Blocks computed at once, with each step done for every block in turn so
+  // that the compiler can vectorise it
+  static const size_t PARALLEL_BLOCKS = 4;
+
+  static const size_t BUFFER_LIMBS = BLOCK_WORDS * PARALLEL_BLOCKS / 2;
+
+  typedef uint32_t blocks_type[BLOCK_WORDS][PARALLEL_BLOCKS];
+
+  key_type key;
+  uint64_t stream;
+  uint64_t counter;
+
+  // Keystream not handed out yet, from buffer + BUFFER_LIMBS - buffered
+  BigInt::limb_type buffer[BUFFER_LIMBS];
+  size_t buffered;
+
+  // The key every thread's generator is keyed with, and a count of the times
+  // it has been set, so that threads know when to rekey
+  static key_type seed_key;
+  static std::atomic<unsigned long> seed_generation;
+  static uint64_t next_stream;
+  static std::mutex seed_mutex;
+
+  ChaCha20();
+
+  static void quarter_round(blocks_type &x, size_t a, size_t b, size_t c,
+                            size_t d);
+
+  // Fill the buffer with the next PARALLEL_BLOCKS blocks of keystream
+  void refill();
+
+public:
+  void rekey(const key_type &key, uint64_t stream);
+
+  // Fill out with count limbs of keystream
+  void fill(BigInt::limb_type *out, size_t count);
+
+  // Key every thread's generator with key, including those already in use
+  static void seed(const key_type &key);
+
+  // The calling thread's generator, which is keyed with an all zero key
+  // until seed is called
+  static ChaCha20 &local();
+};
@@ -0,0 +1,27 @@
+#include "elgamalkey.hpp"
+
+ElGamalKey::ElGamalKey(const parameters_type &parameters)
+    : q(std::get<1>(parameters)), g(std::get<2>(parameters)),
+      h(std::get<3>(parameters)),
+      p_f(std::make_shared<ModIntFactory>(std::get<0>(parameters))),
+      pads(PAD_CAPACITY, [this] { return generate_pad(); }) {}
+
+ElGamalKey::Pad ElGamalKey::generate_pad() const {
+#ifdef FIX_KEY
+  BigInt k(1);
+#else
+  BigInt k = random_bigint(BigInt(1), q);
+#endif
+
+  // g and h recur for every pad, so use fixed-base tables for them. k < q,
+  // so q bounds the size of the exponent.
+  return Pad{p_f->fixed_base_pow(g, k, q.log_2()),
+             p_f->fixed_base_pow(h, k, q.log_2())};
+}
+
+void ElGamalKey::encrypt(const BigInt &m, BigInt &c1, BigInt &c2) const {
+  PadPool<Pad>::pad_pointer_type pad = pads.take();
+
+  c1 = static_cast<BigInt>(pad->g_k);
+  c2 = static_cast<BigInt>((m % *p_f) * pad->h_k);
+}
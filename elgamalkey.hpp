@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <tuple>
+
+#include "bigint.hpp"
+#include "modint.hpp"
+#include "modintfactory.hpp"
+#include "padpool.hpp"
+#include "randint.hpp"
+
+// An ElGamal public key, with the random part of each encryption, g^k and
+// h^k, precomputed in the background. An encryption with a pad ready is then
+// a single multiplication.
+class ElGamalKey {
+public:
+  // p, q, g and h
+  typedef std::tuple<BigInt, BigInt, BigInt, BigInt> parameters_type;
+
+  static const size_t PAD_CAPACITY = 64;
+
+private:
+  // g^k and h^k mod p for a random k < q
+  struct Pad {
+    ModInt g_k, h_k;
+  };
+
+  const BigInt q, g, h;
+
+  const std::shared_ptr<const ModIntFactory> p_f;
+
+  Pad generate_pad() const;
+
+  // Each encryption uses up a pad, and encrypt is const so that a cached key
+  // can serve every record that shares it
+  mutable PadPool<Pad> pads;
+
+public:
+  ElGamalKey(const parameters_type &parameters);
+
+  // c1 = g^k and c2 = m h^k mod p, for a random k
+  void encrypt(const BigInt &m, BigInt &c1, BigInt &c2) const;
+};
@@ -0,0 +1,43 @@
+#include "fixedbase.hpp"
+
+FixedBase::FixedBase(const ModInt &base, BigInt::bit_index_type exponent_bits)
+    : base(base), exponent_bits(exponent_bits) {
+  BigInt::bit_index_type window_count =
+      (exponent_bits + WINDOW_WIDTH - 1) / WINDOW_WIDTH;
+
+  table.reserve(window_count * DIGITS_PER_WINDOW);
+
+  // base^(2^(w i))
+  ModInt window_base = base;
+
+  for (BigInt::bit_index_type i = 0; i < window_count; ++i) {
+    table.push_back(window_base);
+
+    for (BigInt::limb_type d = 2; d <= DIGITS_PER_WINDOW; ++d) {
+      table.push_back(table.back() * window_base);
+    }
+
+    // base^(2^(w (i + 1))) = base^(2^(w i)) ^ (2^w)
+    window_base = table.back() * window_base;
+  }
+}
+
+ModInt FixedBase::pow(const BigInt &n) const {
+  if (n.log_2() > exponent_bits) {
+    return base.pow(n);
+  }
+
+  ModInt result = base.one();
+
+  BigInt::bit_index_type log_n = n.log_2();
+
+  for (BigInt::bit_index_type i = 0; i * WINDOW_WIDTH < log_n; ++i) {
+    BigInt::limb_type digit = n.window(i * WINDOW_WIDTH, WINDOW_WIDTH);
+
+    if (digit != 0) {
+      result = result * table[i * DIGITS_PER_WINDOW + digit - 1];
+    }
+  }
+
+  return result;
+}
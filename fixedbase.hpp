@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include "bigint.hpp"
+#include "modint.hpp"
+
+// Exponentiation of a base that is used many times, by precomputing
+// base^(d 2^(w i)) for every w-bit window i and digit d of the exponent. An
+// exponentiation is then one multiplication per non-zero window, and no
+// squarings at all.
+class FixedBase {
+public:
+  static const BigInt::bit_count_type WINDOW_WIDTH = 4;
+  static const BigInt::limb_type DIGITS_PER_WINDOW = (1 << WINDOW_WIDTH) - 1;
+
+private:
+  const ModInt base;
+  const BigInt::bit_index_type exponent_bits;
+
+  // base^(d 2^(w i)) at index i * DIGITS_PER_WINDOW + d - 1
+  std::vector<ModInt> table;
+
+public:
+  // Precompute for exponents of up to exponent_bits bits
+  FixedBase(const ModInt &base, BigInt::bit_index_type exponent_bits);
+
+  // calculate base^n
+  ModInt pow(const BigInt &n) const;
+};
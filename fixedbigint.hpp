@@ -0,0 +1,73 @@
+#pragma once
+
+#include <type_traits>
+
+#include "bigint.hpp"
+
+// Montgomery arithmetic for a modulus of exactly Bits / LIMB_WIDTH limbs,
+// built from BigInt's kernels with the limb count fixed at compile time, so
+// that every loop has a constant trip count the compiler can unroll. The
+// scratch lives on the stack. The kernels take the same arguments as BigInt's
+// fixed-length ones, so a ModIntFactory can use either, and like them they
+// never branch on or index memory by the values of their operands.
+template <BigInt::limbs_size_type Bits> class FixedBigInt {
+public:
+  typedef BigInt::limb_type limb_type;
+  typedef BigInt::double_limb_type double_limb_type;
+  typedef BigInt::limbs_type limbs_type;
+  typedef BigInt::limbs_iter_type limbs_iter_type;
+  typedef BigInt::limbs_const_iter_type limbs_const_iter_type;
+  typedef BigInt::limbs_index_type limbs_index_type;
+  typedef BigInt::limbs_size_type limbs_size_type;
+
+  static const limbs_size_type LIMBS = Bits / BigInt::LIMB_WIDTH;
+
+private:
+  // Passed to BigInt's kernels as their limb count, so that it is known at
+  // compile time
+  typedef std::integral_constant<limbs_size_type, LIMBS> limb_count_type;
+
+public:
+  // result = lhs * rhs / β^LIMBS mod mod. result may alias lhs or rhs. n must
+  // be LIMBS and t is unused.
+  static void montgomery_multiply(limbs_iter_type result,
+                                  limbs_const_iter_type lhs,
+                                  limbs_const_iter_type rhs,
+                                  limbs_const_iter_type mod, limbs_size_type n,
+                                  limb_type mod_neg_inv, limbs_iter_type t);
+
+  // result = value^2 / β^LIMBS mod mod. n must be LIMBS and t is unused.
+  static void montgomery_square(limbs_iter_type result,
+                                limbs_const_iter_type value,
+                                limbs_const_iter_type mod, limbs_size_type n,
+                                limb_type mod_neg_inv, limbs_type &t);
+};
+
+template <BigInt::limbs_size_type Bits>
+void FixedBigInt<Bits>::montgomery_multiply(
+    limbs_iter_type result, limbs_const_iter_type lhs,
+    limbs_const_iter_type rhs, limbs_const_iter_type mod, limbs_size_type,
+    limb_type mod_neg_inv, limbs_iter_type) {
+  limb_type t[2 * LIMBS + 1] = {};
+
+  for (limbs_index_type i = 0; i < LIMBS; ++i) {
+    t[i + LIMBS] =
+        BigInt::multiply_add_n(t + i, lhs, limb_count_type(), rhs[i]);
+  }
+
+  BigInt::montgomery_reduce_n(result, t, mod, limb_count_type(), mod_neg_inv);
+}
+
+template <BigInt::limbs_size_type Bits>
+void FixedBigInt<Bits>::montgomery_square(limbs_iter_type result,
+                                          limbs_const_iter_type value,
+                                          limbs_const_iter_type mod,
+                                          limbs_size_type,
+                                          limb_type mod_neg_inv,
+                                          limbs_type &) {
+  limb_type t[2 * LIMBS + 1] = {};
+
+  BigInt::square_n(t, value, limb_count_type());
+
+  BigInt::montgomery_reduce_n(result, t, mod, limb_count_type(), mod_neg_inv);
+}
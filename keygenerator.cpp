@@ -0,0 +1,61 @@
+#include "keygenerator.hpp"
+
+BigInt KeyGenerator::rsa_prime(BigInt::bit_index_type bits,
+                               unsigned int threads) {
+  for (;;) {
+    BigInt prime = PrimeGenerator::random_prime(bits, threads);
+
+    // e is prime, so it's coprime to prime - 1 unless it divides it
+    BigInt remainder = prime - 1;
+    remainder %= BigInt(RSA_PUBLIC_EXPONENT);
+
+    if (remainder != 0) {
+      return prime;
+    }
+  }
+}
+
+KeyGenerator::key_type KeyGenerator::rsa(BigInt::bit_index_type bits,
+                                         unsigned int threads) {
+  BigInt p = rsa_prime(bits - bits / 2, threads), q;
+
+  do {
+    q = rsa_prime(bits / 2, threads);
+  } while (q == p);
+
+  BigInt e(RSA_PUBLIC_EXPONENT);
+
+  BigInt phi = (p - 1) * (q - 1);
+  BigInt d = BigInt::mod_inv(e, phi);
+
+  BigInt d_p = d, d_q = d;
+  d_p %= p - 1;
+  d_q %= q - 1;
+
+  return key_type{p * q, e, d, p, q, d_p, d_q, BigInt::mod_inv(p, q),
+                  BigInt::mod_inv(q, p)};
+}
+
+KeyGenerator::key_type KeyGenerator::elgamal(BigInt::bit_index_type bits,
+                                             unsigned int threads) {
+  BigInt p = PrimeGenerator::random_safe_prime(bits, threads);
+
+  BigInt q = p - 1;
+  q >>= BigInt::Bits(1);
+
+  ModIntFactory p_f(p);
+
+  // Squares have order q or 1, as the group has order 2q
+  BigInt g;
+
+  do {
+    BigInt base = random_bigint(BigInt(2), p - 1);
+    g = static_cast<BigInt>((base % p_f).square());
+  } while (g == 1);
+
+  BigInt x = random_bigint(BigInt(1), q);
+
+  BigInt h = static_cast<BigInt>((g % p_f).pow(x));
+
+  return key_type{p, q, g, h, x};
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+#include "bigint.hpp"
+#include "modint.hpp"
+#include "modintfactory.hpp"
+#include "primegenerator.hpp"
+#include "randint.hpp"
+
+// Keys for the stages, with their primes found by PrimeGenerator
+class KeyGenerator {
+public:
+  typedef std::vector<BigInt> key_type;
+
+  static const BigInt::limb_type RSA_PUBLIC_EXPONENT = 65537;
+
+  // N, e, d, p, q, d_p, d_q, i_p and i_q, for an N of bits bits
+  static key_type rsa(BigInt::bit_index_type bits, unsigned int threads = 1);
+
+  // p, q, g, h and x, where p = 2q + 1 is a safe prime of bits bits, g
+  // generates the subgroup of order q and h = g^x
+  static key_type elgamal(BigInt::bit_index_type bits,
+                          unsigned int threads = 1);
+
+private:
+  // A prime of bits bits for which RSA_PUBLIC_EXPONENT has an inverse
+  static BigInt rsa_prime(BigInt::bit_index_type bits, unsigned int threads);
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+using std::invalid_argument;
+
+// A bounded queue that any number of threads can push to and pop from
+// without locking, after Dmitry Vyukov's bounded MPMC queue. Each cell
+// carries a sequence number saying whether it's ready to be pushed to or
+// popped from on the current lap of the ring.
+template <class T> class LockFreeRing {
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  const size_t mask;
+  std::unique_ptr<Cell[]> cells;
+
+  std::atomic<size_t> push_position;
+  std::atomic<size_t> pop_position;
+
+public:
+  // capacity must be a power of two
+  LockFreeRing(size_t capacity);
+
+  LockFreeRing(const LockFreeRing &) = delete;
+  LockFreeRing &operator=(const LockFreeRing &) = delete;
+
+  // Move value in, unless the ring is full
+  bool try_push(T &&value);
+
+  // Move the oldest value out, unless the ring is empty
+  bool try_pop(T &value);
+};
+
+template <class T>
+LockFreeRing<T>::LockFreeRing(size_t capacity)
+    : mask(capacity - 1), cells(new Cell[capacity]), push_position(0),
+      pop_position(0) {
+  if (capacity == 0 || (capacity & mask) != 0) {
+    throw invalid_argument("ring capacity must be a power of two");
+  }
+
+  for (size_t i = 0; i < capacity; ++i) {
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+template <class T> bool LockFreeRing<T>::try_push(T &&value) {
+  size_t position = push_position.load(std::memory_order_relaxed);
+
+  for (;;) {
+    Cell &cell = cells[position & mask];
+    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    intptr_t lap = static_cast<intptr_t>(sequence - position);
+
+    if (lap == 0) {
+      // The cell is free on this lap, so claim it
+      if (push_position.compare_exchange_weak(position, position + 1,
+                                              std::memory_order_relaxed)) {
+        cell.value = std::move(value);
+        cell.sequence.store(position + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (lap < 0) {
+      // Still holding a value from the previous lap
+      return false;
+    } else {
+      position = push_position.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <class T> bool LockFreeRing<T>::try_pop(T &value) {
+  size_t position = pop_position.load(std::memory_order_relaxed);
+
+  for (;;) {
+    Cell &cell = cells[position & mask];
+    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    intptr_t lap = static_cast<intptr_t>(sequence - (position + 1));
+
+    if (lap == 0) {
+      if (pop_position.compare_exchange_weak(position, position + 1,
+                                             std::memory_order_relaxed)) {
+        value = std::move(cell.value);
+        // Free the cell for the next lap
+        cell.sequence.store(position + mask + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (lap < 0) {
+      // Not pushed to yet on this lap
+      return false;
+    } else {
+      position = pop_position.load(std::memory_order_relaxed);
+    }
+  }
+}
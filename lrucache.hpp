@@ -0,0 +1,117 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+using std::invalid_argument;
+
+// A least recently used cache of values built from their keys, so that
+// records sharing a key share whatever was precomputed for it. Value must be
+// constructible from a Key. Safe to share between threads.
+template <class Key, class Value> class LruCache {
+public:
+  typedef std::shared_ptr<const Value> pointer_type;
+  typedef size_t size_type;
+
+private:
+  typedef std::pair<Key, pointer_type> entry_type;
+  // Most recently used first
+  typedef std::list<entry_type> entries_type;
+
+  const size_type capacity;
+
+  mutable std::mutex mutex;
+
+  entries_type entries;
+  std::map<Key, typename entries_type::iterator> index;
+
+  unsigned long hit_count;
+  unsigned long miss_count;
+
+public:
+  LruCache(size_type capacity);
+
+  // The value for key, creating it if it isn't cached. Evicted values stay
+  // alive for as long as a caller holds on to them. Two threads missing on
+  // the same key may both build a value, but only the first is cached and
+  // returned.
+  pointer_type get(const Key &key);
+
+  unsigned long hits() const;
+  unsigned long misses() const;
+};
+
+template <class Key, class Value>
+LruCache<Key, Value>::LruCache(size_type capacity)
+    : capacity(capacity), hit_count(0), miss_count(0) {
+  if (capacity == 0) {
+    throw invalid_argument("cache capacity cannot be zero");
+  }
+}
+
+template <class Key, class Value>
+typename LruCache<Key, Value>::pointer_type
+LruCache<Key, Value>::get(const Key &key) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto index_iter = index.find(key);
+
+    if (index_iter != index.end()) {
+      ++hit_count;
+
+      entries.splice(entries.begin(), entries, index_iter->second);
+
+      return index_iter->second->second;
+    }
+
+    ++miss_count;
+  }
+
+  // Build the value without holding the lock, which would stall every other
+  // key's lookups behind it
+  pointer_type value = std::make_shared<Value>(key);
+
+  // Declared before the lock, so an evicted value is destroyed after it's
+  // released
+  pointer_type evicted;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto index_iter = index.find(key);
+
+  if (index_iter != index.end()) {
+    // Another thread built it first, so share that one
+    entries.splice(entries.begin(), entries, index_iter->second);
+
+    return index_iter->second->second;
+  }
+
+  entries.push_front(entry_type(key, value));
+  index[key] = entries.begin();
+
+  if (entries.size() > capacity) {
+    evicted = entries.back().second;
+
+    index.erase(entries.back().first);
+    entries.pop_back();
+  }
+
+  return value;
+}
+
+template <class Key, class Value>
+unsigned long LruCache<Key, Value>::hits() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return hit_count;
+}
+
+template <class Key, class Value>
+unsigned long LruCache<Key, Value>::misses() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return miss_count;
+}
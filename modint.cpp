@@ -9,29 +9,10 @@ ModInt ModInt::create_from_same_factory(const BigInt &value) const {
   return factory->create_int(value);
 }
 
-void ModInt::reduce(BigInt &value, const ModIntFactory &factory) {
-  value.trim();
-
-  BigInt::limb_type mod0 = factory.mod.least_significant_limb_value();
-
-  BigInt::limb_type inv_mod0 = BigInt::mod_inv(mod0, BigInt::LIMB_MODULUS);
-
-  BigInt::limb_type neg_inv_mod0 = BigInt::LIMB_MODULUS - inv_mod0;
-
-  BigInt::limbs_size_type limb_count = factory.mod.limb_count();
-
-  for (BigInt::limbs_size_type n = 0; n < limb_count; ++n) {
-    BigInt::limb_type k = (value.least_significant_limb_value() * neg_inv_mod0);
-
-    k &= BigInt::LIMB_MASK;
+ModInt ModInt::one() const { return factory->one(); }
 
-    value += factory.mod * k;
-    value >>= BigInt::Limbs(1);
-  }
-
-  if (value > factory.mod) {
-    value %= factory.mod;
-  }
+void ModInt::reduce(BigInt &value, const ModIntFactory &factory) {
+  BigInt::montgomery_reduce(value, factory.mod, factory.mod_neg_inv);
 }
 
 void ModInt::reduce() { reduce(value, *factory); }
@@ -85,106 +66,394 @@ ModInt operator-(const ModInt &lhs, const ModInt &rhs) {
 }
 
 ModInt operator*(const ModInt &a, const ModInt &b) {
+  ModInt result;
+  ModInt::multiply(result, a, b);
+  return result;
+}
+
+void ModInt::multiply(ModInt &result, const ModInt &a, const ModInt &b) {
   if (a.factory == b.factory) {
-    return ModInt(a.value * b.value, a.factory);
+    const ModIntFactory &factory = *a.factory;
+    BigInt::limbs_size_type limbs = factory.limb_count;
+
+    ScratchArena::Frame frame(ScratchArena::local());
+    BigInt::limbs_type &lhs = frame.acquire(limbs);
+    BigInt::limbs_type &rhs = frame.acquire(limbs);
+    BigInt::limbs_type &t = frame.acquire(limbs + 2);
+
+    a.value.copy_limbs(lhs.begin(), limbs);
+    b.value.copy_limbs(rhs.begin(), limbs);
+
+    factory.multiply_kernel(lhs.begin(), lhs.cbegin(), rhs.cbegin(),
+                            factory.kernel_mod.cbegin(), limbs,
+                            factory.mod_neg_inv, t.begin());
+
+    result.value.assign(lhs.cbegin(), lhs.cend());
+    result.factory = a.factory;
   } else {
     throw domain_error("Montgomery multiplication must "
                        "be over the same modulus!");
   }
 }
 
-// https://wikimedia.org/api/rest_v1/media/math/render/svg/1e865f7688532c911e9c0f65df83d8d3976b2ecc
-bool ModInt::sliding_window_k_check(BigInt::bit_index_type log_n,
-                                    BigInt::bit_index_type k) {
-  return log_n <
-         ((k * (k + 1) * (1 << (2 * k))) / ((1 << (k + 1)) - k - 2) + 1);
+ModInt ModInt::square() const {
+  BigInt::limbs_size_type limbs = factory->limb_count;
+
+  ScratchArena::Frame frame(ScratchArena::local());
+  BigInt::limbs_type &square = frame.acquire(limbs);
+  BigInt::limbs_type &t = frame.acquire(2 * limbs + 1);
+
+  value.copy_limbs(square.begin(), limbs);
+
+  factory->square_kernel(square.begin(), square.cbegin(),
+                         factory->kernel_mod.cbegin(), limbs,
+                         factory->mod_neg_inv, t);
+
+  ModInt result;
+  result.value.assign(square.cbegin(), square.cend());
+  result.factory = factory;
+
+  return result;
 }
 
-ptrdiff_t ModInt::power_to_array_index(ptrdiff_t p, ptrdiff_t count) {
-  // std::cout << "Power: " << p << std::endl;
-  ptrdiff_t i = (p - 1) / 2;
-  // std::cout << "Index: " << i << std::endl;
-  // std::cout << "Count: " << count << std::endl;
-  if ((i >= 0) && (i < count)) {
-    return i;
-  } else {
-    throw out_of_range(
-        "Sliding window precalculated item array lookup out of range!");
-  }
+BigInt ModInt::multiply_plain(const BigInt &value) const {
+  ModInt plain;
+  plain.value = value;
+  plain.factory = factory;
+
+  ModInt product;
+  multiply(product, *this, plain);
+
+  return product.value;
 }
 
 ModInt ModInt::pow(const BigInt &n) const { return ModInt::pow(*this, n); }
 
-// https://en.wikipedia.org/wiki/Exponentiation_by_squaring#Sliding_window_method
+ModInt ModInt::pow_constant_time(const BigInt &n) const {
+  ModInt result;
+  pow_constant_time(result, *this, n);
+  return result;
+}
+
+void ModInt::pow_constant_time(ModInt &result, const ModInt &x,
+                               const BigInt &n) {
+  const ModIntFactory &factory = *x.factory;
+  BigInt::limbs_size_type limbs = factory.limb_count;
+  BigInt::limbs_const_iter_type mod = factory.kernel_mod.cbegin();
+
+  // Read the exponent as exactly as many limbs as the modulus, in a whole
+  // number of windows, so the work depends only on the public size of the
+  // modulus and not on the length of the exponent
+  BigInt::bit_index_type exponent_bits = limbs * BigInt::LIMB_WIDTH;
+
+  // Wider windows mean fewer multiplies but a larger table to build and scan
+  // on every window. These widths are the fastest bench/constanttime finds.
+  BigInt::bit_count_type width =
+      exponent_bits <= 512 ? 4 : exponent_bits <= 2048 ? 5 : 6;
+  BigInt::bit_index_type window_count = (exponent_bits + width - 1) / width;
+
+  BigInt::limbs_size_type table_count =
+      static_cast<BigInt::limbs_size_type>(1) << width;
+
+  ScratchArena::Frame frame(ScratchArena::local());
+  // x^d at d * limbs, for every possible window value d
+  BigInt::limbs_type &table = frame.acquire(table_count * limbs);
+  BigInt::limbs_type &acc = frame.acquire(limbs);
+  BigInt::limbs_type &digit_power = frame.acquire(limbs);
+  BigInt::limbs_type &t = frame.acquire(limbs + 2);
+  BigInt::limbs_type &square_t = frame.acquire(2 * limbs + 1);
+  // The exponent, with a zero limb above for the top window to run into
+  BigInt::limbs_type &exponent = frame.acquire(limbs + 1);
+
+  n.copy_limbs(exponent.begin(), limbs);
+  exponent[limbs] = 0;
+
+  factory.montgomery_one.copy_limbs(table.begin(), limbs);
+  x.value.copy_limbs(table.begin() + limbs, limbs);
+
+  // Squaring is cheaper than multiplying, so x^2d = (x^d)^2
+  for (BigInt::limbs_index_type d = 2; d < table_count; ++d) {
+    if (d % 2 == 0) {
+      factory.square_kernel(table.begin() + d * limbs,
+                            table.cbegin() + d / 2 * limbs, mod, limbs,
+                            factory.mod_neg_inv, square_t);
+    } else {
+      factory.multiply_kernel(table.begin() + d * limbs,
+                              table.cbegin() + (d - 1) * limbs,
+                              table.cbegin() + limbs, mod, limbs,
+                              factory.mod_neg_inv, t.begin());
+    }
+  }
+
+  BigInt::select_limbs(
+      acc.begin(), table.cbegin(), limbs, table_count,
+      BigInt::window_limbs(exponent.cbegin(), (window_count - 1) * width,
+                           width));
+
+  for (BigInt::bit_index_type window = window_count - 1; window-- > 0;) {
+    for (BigInt::bit_count_type bit = 0; bit < width; ++bit) {
+      factory.square_kernel(acc.begin(), acc.cbegin(), mod, limbs,
+                            factory.mod_neg_inv, square_t);
+    }
+
+    BigInt::select_limbs(
+        digit_power.begin(), table.cbegin(), limbs, table_count,
+        BigInt::window_limbs(exponent.cbegin(), window * width, width));
+
+    factory.multiply_kernel(acc.begin(), acc.cbegin(), digit_power.cbegin(),
+                            mod, limbs, factory.mod_neg_inv, t.begin());
+  }
+
+  result.value.assign(acc.cbegin(), acc.cend());
+  result.factory = x.factory;
+}
+
 ModInt ModInt::pow(const ModInt &x, const BigInt &n) {
-  BigInt::bit_index_type log_n = n.log_2();
+  ModInt result;
+  pow(result, x, n);
+  return result;
+}
 
-  BigInt::bit_index_type k = 1;
+void ModInt::pow(ModInt &result, const ModInt &x, const BigInt &n) {
+  // Kept between calls so that splitting n into windows doesn't allocate
+  static thread_local WindowedExponent windows;
 
-  while (!sliding_window_k_check(log_n, k)) {
-    ++k;
+  windows.assign(n);
+  pow(result, x, windows);
+}
+
+void ModInt::pow(ModInt &result, const ModInt &x,
+                 const WindowedExponent &n) {
+  const ModIntFactory &factory = *x.factory;
+
+  if (n.begin() == n.end()) {
+    result.value = factory.montgomery_one;
+    result.factory = x.factory;
+    return;
   }
 
-  // std::cout << "k:" << k << std::endl;
+  BigInt::limbs_size_type limbs = factory.limb_count;
+  BigInt::limbs_const_iter_type mod = factory.kernel_mod.cbegin();
+
+  // Every window is odd, so only the odd powers x, x^3, ..., x^(2^k - 1)
+  BigInt::limbs_size_type odd_power_count =
+      static_cast<BigInt::limbs_size_type>(1) << (n.max_width() - 1);
+
+  ScratchArena::Frame frame(ScratchArena::local());
+  // x^(2j + 1) at j * limbs
+  BigInt::limbs_type &odd_powers = frame.acquire(odd_power_count * limbs);
+  BigInt::limbs_type &x_squared = frame.acquire(limbs);
+  BigInt::limbs_type &y = frame.acquire(limbs);
+  BigInt::limbs_type &t = frame.acquire(limbs + 2);
+  BigInt::limbs_type &square_t = frame.acquire(2 * limbs + 1);
+
+  auto multiply = [&](BigInt::limbs_iter_type product,
+                      BigInt::limbs_const_iter_type lhs,
+                      BigInt::limbs_const_iter_type rhs) {
+    factory.multiply_kernel(product, lhs, rhs, mod, limbs, factory.mod_neg_inv,
+                            t.begin());
+  };
+
+  auto square = [&](BigInt::limbs_iter_type product,
+                    BigInt::limbs_const_iter_type value) {
+    factory.square_kernel(product, value, mod, limbs, factory.mod_neg_inv,
+                          square_t);
+  };
+
+  x.value.copy_limbs(odd_powers.begin(), limbs);
+  square(x_squared.begin(), odd_powers.cbegin());
+
+  for (BigInt::limbs_index_type j = 1; j < odd_power_count; ++j) {
+    multiply(odd_powers.begin() + j * limbs,
+             odd_powers.cbegin() + (j - 1) * limbs, x_squared.cbegin());
+  }
 
-  ptrdiff_t precalculated_items_count = 1 << k;
+  // The first window starts y off, so y = 1 is never squared
+  WindowedExponent::window_iter_type window = n.begin();
 
-  // std::cout << "Precaclulated items count: " << precalculated_items_count
-  //    << std::endl;
+  BigInt::limbs_const_iter_type odd_power =
+      odd_powers.cbegin() + window->odd_power * limbs;
+  std::copy(odd_power, odd_power + limbs, y.begin());
 
-  ModInt precalculated_items[precalculated_items_count];
+  for (++window; window != n.end(); ++window) {
+    for (BigInt::bit_index_type h = 0; h < window->squarings; ++h) {
+      square(y.begin(), y.cbegin());
+    }
+
+    multiply(y.begin(), y.cbegin(),
+             odd_powers.cbegin() + window->odd_power * limbs);
+  }
 
-  ModInt x_squared = x * x;
+  for (BigInt::bit_index_type h = 0; h < n.squarings_after(); ++h) {
+    square(y.begin(), y.cbegin());
+  }
+
+  result.value.assign(y.cbegin(), y.cend());
+  result.factory = x.factory;
+}
 
-  precalculated_items[0] = x;
+BigInt::bit_index_type ModInt::max_exponent_bits(
+    const std::vector<std::pair<ModInt, BigInt>> &powers) {
+  BigInt::bit_index_type bits = 0;
 
-  for (ptrdiff_t i = 1; i < precalculated_items_count; ++i) {
-    precalculated_items[i] = precalculated_items[i - 1] * x_squared;
+  for (const auto &power : powers) {
+    bits = std::max(bits, power.second.log_2());
   }
 
-  // 1.  y := 1; i := l-1
-  ModInt y = x.create_from_same_factory(BigInt(1));
+  return bits;
+}
+
+ModInt
+ModInt::multi_pow(const std::vector<std::pair<ModInt, BigInt>> &powers) {
+  if (powers.empty()) {
+    throw invalid_argument("multi_pow needs at least one power");
+  }
+
+  for (const auto &power : powers) {
+    if (power.first.factory != powers.front().first.factory) {
+      throw domain_error("Multi exponentiation must "
+                         "be over the same modulus!");
+    }
+  }
+
+  // x_1^n x_2^n ... = (x_1 x_2 ...)^n, so a shared exponent needs one chain
+  bool same_exponent = true;
 
-  BigInt::bit_index_type i = n.log_2();
+  for (const auto &power : powers) {
+    same_exponent = same_exponent && power.second == powers.front().second;
+  }
+
+  if (same_exponent) {
+    ModInt product = powers.front().first;
 
-  // 2.  while i > -1 do
-  while (i > -1) {
-    // std::cout << "i: " << i << std::endl;
-    // 3.      if ni=0 then y:=y2' i:=i-1
-    if (n[i] == 0) {
-      // std::cout << "Zero" << std::endl;
-      y = y * y;
-      --i;
+    for (auto iter = powers.cbegin() + 1; iter != powers.cend(); ++iter) {
+      product = product * iter->first;
     }
-    // 4.      else
-    else {
-      // 5.          s:=max{i-k+1,0}
-      BigInt::bit_index_type s =
-          std::max(i - k + 1, static_cast<BigInt::bit_index_type>(0));
-
-      // 6.          while ns=0 do s:=s+1 [notes 1]
-      while (n[s] == 0) {
-        ++s;
+
+    return product.pow(powers.front().second);
+  } else if (powers.size() < PIPPENGER_THRESHOLD) {
+    return straus_multi_pow(powers);
+  } else {
+    return pippenger_multi_pow(powers);
+  }
+}
+
+// Straus' method: one chain of squarings, multiplying in every x^d for the
+// w-bit digit d of each exponent, with a table of x^1 ... x^(2^w - 1) per x
+ModInt ModInt::straus_multi_pow(
+    const std::vector<std::pair<ModInt, BigInt>> &powers) {
+  const BigInt::bit_count_type w = 4;
+
+  std::vector<std::vector<ModInt>> tables;
+  tables.reserve(powers.size());
+
+  for (const auto &power : powers) {
+    std::vector<ModInt> table(1, power.first);
+
+    for (BigInt::limb_type d = 2; d < (1 << w); ++d) {
+      table.push_back(table.back() * power.first);
+    }
+
+    tables.push_back(table);
+  }
+
+  ModInt y = powers.front().first.one();
+  bool started = false;
+
+  for (BigInt::bit_index_type position =
+           (max_exponent_bits(powers) + w - 1) / w * w;
+       position > 0;) {
+    position -= w;
+
+    if (started) {
+      for (BigInt::bit_count_type h = 0; h < w; ++h) {
+        y = y.square();
       }
-      // 7.          for h:=1 to i-s+1 do y:=y2
-      for (BigInt::bit_index_type h = 1; h <= i - s + 1; ++h) {
-        y = y * y;
+    }
+
+    for (size_t i = 0; i < powers.size(); ++i) {
+      BigInt::limb_type digit = powers[i].second.window(position, w);
+
+      if (digit != 0) {
+        y = y * tables[i][digit - 1];
+        started = true;
       }
-      // 8.          u:=(ni,ni-1,....,ns)2
-      size_t u = 0;
-      for (BigInt::bit_index_type h = i; h >= s; --h) {
-        u = (u << 1) + n[h];
+    }
+  }
+
+  return y;
+}
+
+// Pippenger's bucket method: per window, multiply each x into the bucket for
+// its digit d, then combine the buckets into the product of bucket_d^d
+ModInt ModInt::pippenger_multi_pow(
+    const std::vector<std::pair<ModInt, BigInt>> &powers) {
+  // Roughly log2 of the number of powers
+  BigInt::bit_count_type w = 1;
+
+  while (w < BigInt::LIMB_WIDTH / 4 &&
+         (static_cast<size_t>(4) << w) <= powers.size()) {
+    ++w;
+  }
+
+  const BigInt::limb_type bucket_count =
+      (static_cast<BigInt::limb_type>(1) << w) - 1;
+
+  ModInt one = powers.front().first.one();
+  ModInt y = one;
+  bool started = false;
+
+  std::vector<ModInt> buckets(bucket_count, one);
+  std::vector<bool> bucket_used(bucket_count);
+
+  for (BigInt::bit_index_type position =
+           (max_exponent_bits(powers) + w - 1) / w * w;
+       position > 0;) {
+    position -= w;
+
+    if (started) {
+      for (BigInt::bit_count_type h = 0; h < w; ++h) {
+        y = y.square();
+      }
+    }
+
+    std::fill(bucket_used.begin(), bucket_used.end(), false);
+
+    for (const auto &power : powers) {
+      BigInt::limb_type digit = power.second.window(position, w);
+
+      if (digit != 0) {
+        if (bucket_used[digit - 1]) {
+          buckets[digit - 1] = buckets[digit - 1] * power.first;
+        } else {
+          buckets[digit - 1] = power.first;
+          bucket_used[digit - 1] = true;
+        }
       }
-      // std::cout << "u: " << u << std::endl;
-      // 9.          y:=y*xu
-      y = precalculated_items[power_to_array_index(u,
-                                                   precalculated_items_count)] *
-          y;
-      // 10.         i:=s-1
-      i = s - 1;
+    }
+
+    // bucket_d^d for every d, as the running products
+    // bucket_max, bucket_max bucket_(max - 1), ...
+    ModInt running = one, window_product = one;
+    bool running_used = false;
+
+    for (BigInt::limb_type d = bucket_count; d > 0; --d) {
+      if (bucket_used[d - 1]) {
+        running = running_used ? running * buckets[d - 1] : buckets[d - 1];
+        running_used = true;
+      }
+
+      if (running_used) {
+        window_product = window_product * running;
+      }
+    }
+
+    if (running_used) {
+      y = y * window_product;
+      started = true;
     }
   }
-  // 11. return y
+
   return y;
 }
 
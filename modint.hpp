@@ -1,10 +1,13 @@
 #pragma once
 
 #include <algorithm>
+#include <utility>
+#include <vector>
 
 #include "bigint.hpp"
+#include "scratcharena.hpp"
+#include "windowedexponent.hpp"
 
-using std::out_of_range;
 using std::runtime_error;
 
 class ModInt;
@@ -21,26 +24,65 @@ private:
 
   static void reduce(BigInt &value, const ModIntFactory &factory);
 
-  void reduce();
+  // result = a * b, fusing the product with its Montgomery reduction
+  static void multiply(ModInt &result, const ModInt &a, const ModInt &b);
 
-  static bool sliding_window_k_check(BigInt::bit_index_type log_n,
-                                     BigInt::bit_index_type k);
+  void reduce();
 
-  static ptrdiff_t power_to_array_index(ptrdiff_t p, ptrdiff_t count);
+  static BigInt::bit_index_type
+  max_exponent_bits(const std::vector<std::pair<ModInt, BigInt>> &powers);
 
 public:
   operator BigInt() const;
 
   ModInt create_from_same_factory(const BigInt &value) const;
 
+  // 1 from the same factory
+  ModInt one() const;
+
   ModInt &operator+=(const ModInt &rhs);
   ModInt &operator-=(const ModInt &rhs);
 
   friend ModInt operator*(const ModInt &a, const ModInt &b);
 
+  // *this * *this, but faster
+  ModInt square() const;
+
+  // *this * value mod N as an ordinary integer, where value is an ordinary
+  // integer with at most as many limbs as N. The Montgomery reduction of the
+  // product takes *this out of Montgomery form, so there's no conversion.
+  BigInt multiply_plain(const BigInt &value) const;
+
   // calculate x^n
   ModInt pow(const BigInt &n) const;
   static ModInt pow(const ModInt &x, const BigInt &n);
+  // result = x^n, reusing the storage of result. The working storage comes
+  // from the thread's ScratchArena, so a warmed up thread doesn't allocate.
+  static void pow(ModInt &result, const ModInt &x, const BigInt &n);
+  // result = x^n, for an exponent already split into windows
+  static void pow(ModInt &result, const ModInt &x, const WindowedExponent &n);
+
+  // calculate x^n without leaking n through timing, for secret exponents.
+  // n must have at most as many limbs as the modulus, and the time taken
+  // depends only on the modulus. Throws range_error for a larger n.
+  ModInt pow_constant_time(const BigInt &n) const;
+  static void pow_constant_time(ModInt &result, const ModInt &x,
+                                const BigInt &n);
+
+  // Batches of at least this many powers use Pippenger's bucket method
+  static const size_t PIPPENGER_THRESHOLD = 256;
+
+  // The two methods multi_pow picks between for differing exponents, which
+  // bench/multipow times against each other to place PIPPENGER_THRESHOLD
+  static ModInt
+  straus_multi_pow(const std::vector<std::pair<ModInt, BigInt>> &powers);
+  static ModInt
+  pippenger_multi_pow(const std::vector<std::pair<ModInt, BigInt>> &powers);
+
+  // calculate the product of x^n over every (x, n) in powers, sharing a
+  // single chain of squarings between them
+  static ModInt
+  multi_pow(const std::vector<std::pair<ModInt, BigInt>> &powers);
 
   friend class ModIntFactory;
 };
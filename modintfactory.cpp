@@ -1,20 +1,153 @@
 #include "modintfactory.hpp"
 
-ModIntFactory::ModIntFactory(const BigInt &modulus) : mod(modulus) {
+#include "fixedbase.hpp"
+#include "fixedbigint.hpp"
+#include "vectormontgomery.hpp"
+
+ModIntFactory::FixedBaseEntry::FixedBaseEntry(const BigInt &) : uses(0) {}
+
+ModIntFactory::ModIntFactory(const BigInt &modulus)
+    : mod(modulus), fixed_bases(FIXED_BASE_CAPACITY) {
   mod.trim();
 
-  BigInt range(1);
-  range <<= BigInt::Limbs(mod.limb_count());
+  limb_count = mod.limb_count();
 
-  conversion_factor = range * range;
+  mod_neg_inv = -BigInt::mod_inv(mod.least_significant_limb_value());
 
+  montgomery_one = BigInt(1);
+  montgomery_one <<= BigInt::Limbs(limb_count);
+  montgomery_one %= mod;
+
+  conversion_factor = montgomery_one.square();
   conversion_factor %= mod;
+
+  select_kernels();
+}
+
+template <class Kernels> void ModIntFactory::use_kernels() {
+  multiply_kernel = &Kernels::montgomery_multiply;
+  square_kernel = &Kernels::montgomery_square;
+}
+
+void ModIntFactory::select_kernels() {
+  if (limb_count <= VectorMontgomery::MAX_LIMBS) {
+    if (limb_count >= VectorMontgomery::IFMA_MIN_LIMBS &&
+        VectorMontgomery::ifma_supported()) {
+      multiply_kernel = &VectorMontgomery::multiply_ifma;
+      square_kernel = &VectorMontgomery::square_ifma;
+      kernel_mod = VectorMontgomery::kernel_modulus_ifma(
+          mod.least_significant_limb(), limb_count);
+      return;
+    } else if (limb_count >= VectorMontgomery::AVX2_MIN_LIMBS &&
+               VectorMontgomery::avx2_supported()) {
+      multiply_kernel = &VectorMontgomery::multiply_avx2;
+      square_kernel = &VectorMontgomery::square_avx2;
+      kernel_mod = VectorMontgomery::kernel_modulus_avx2(
+          mod.least_significant_limb(), limb_count);
+      return;
+    }
+  }
+
+  // The scalar kernels take the modulus as it is
+  kernel_mod.assign(mod.least_significant_limb(),
+                    mod.least_significant_limb() + limb_count);
+
+  switch (limb_count) {
+  case FixedBigInt<512>::LIMBS:
+    use_kernels<FixedBigInt<512>>();
+    break;
+  case FixedBigInt<1024>::LIMBS:
+    use_kernels<FixedBigInt<1024>>();
+    break;
+  // 2048 and 4096-bit moduli stay on BigInt's kernels, which bench/fixedwidth
+  // measures as faster at those sizes
+  default:
+    multiply_kernel = &BigInt::montgomery_multiply_fixed;
+    square_kernel = &BigInt::montgomery_square_fixed;
+    break;
+  }
 }
 
 ModInt ModIntFactory::create_int(const BigInt &value) const {
   return ModInt(value * conversion_factor, this);
 }
 
+ModInt ModIntFactory::one() const {
+  ModInt result;
+  result.value = montgomery_one;
+  result.factory = this;
+  return result;
+}
+
+ModInt ModIntFactory::inverse(const ModInt &x) const {
+  if (x.factory != this) {
+    throw domain_error("Inversion must be over the factory's modulus!");
+  }
+
+  // x is stored as a R, whose inverse is a^-1 R^-1
+  ModInt result;
+  result.value = BigInt::mod_inv(x.value, mod);
+  result.factory = this;
+
+  // R^2 stored as is is R in Montgomery form, so each multiplication by it
+  // multiplies by R, giving a^-1 R
+  ModInt r;
+  r.value = conversion_factor;
+  r.factory = this;
+
+  return result * r * r;
+}
+
+std::vector<ModInt>
+ModIntFactory::inverse(const std::vector<ModInt> &values) const {
+  std::vector<ModInt> inverses;
+
+  if (values.empty()) {
+    return inverses;
+  }
+
+  inverses.reserve(values.size());
+
+  // The running products x_0 x_1 ... x_i
+  inverses.push_back(values.front());
+
+  for (size_t i = 1; i < values.size(); ++i) {
+    inverses.push_back(inverses.back() * values[i]);
+  }
+
+  // (x_0 ... x_i)^-1, peeling x_i off to step down to i - 1
+  ModInt product_inverse = inverse(inverses.back());
+
+  for (size_t i = values.size() - 1; i > 0; --i) {
+    inverses[i] = product_inverse * inverses[i - 1];
+    product_inverse = product_inverse * values[i];
+  }
+
+  inverses.front() = product_inverse;
+
+  return inverses;
+}
+
+ModInt
+ModIntFactory::fixed_base_pow(const BigInt &base, const BigInt &n,
+                              BigInt::bit_index_type exponent_bits) const {
+  FixedBaseCache::pointer_type entry = fixed_bases.get(base);
+
+  if (entry->uses++ == 0) {
+    // A one-off base isn't worth the cost of a table
+    return create_int(base).pow(n);
+  }
+
+  // Threads wanting the same table wait for the first to build it, but no
+  // other base is held up
+  std::call_once(entry->built, [&] {
+    entry->fixed_base =
+        std::make_shared<const FixedBase>(create_int(base), exponent_bits);
+  });
+
+  return entry->fixed_base->pow(n);
+}
+
 ModInt operator%(const BigInt &value, const ModIntFactory &factory) {
   return factory.create_int(value);
 }
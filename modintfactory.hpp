@@ -1,21 +1,104 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "bigint.hpp"
+#include "lrucache.hpp"
 
+class FixedBase;
 class ModIntFactory;
 
 #include "modint.hpp"
 
 class ModIntFactory {
+public:
+  // The signatures of the fixed-length Montgomery kernels in BigInt and
+  // FixedBigInt
+  typedef void (*multiply_kernel_type)(BigInt::limbs_iter_type result,
+                                       BigInt::limbs_const_iter_type lhs,
+                                       BigInt::limbs_const_iter_type rhs,
+                                       BigInt::limbs_const_iter_type mod,
+                                       BigInt::limbs_size_type n,
+                                       BigInt::limb_type mod_neg_inv,
+                                       BigInt::limbs_iter_type t);
+  typedef void (*square_kernel_type)(BigInt::limbs_iter_type result,
+                                     BigInt::limbs_const_iter_type value,
+                                     BigInt::limbs_const_iter_type mod,
+                                     BigInt::limbs_size_type n,
+                                     BigInt::limb_type mod_neg_inv,
+                                     BigInt::limbs_type &t);
+
 private:
+  // The modulus N, trimmed to exactly limb_count limbs
   BigInt mod;
+  BigInt::limbs_size_type limb_count;
+
+  // -N^-1 mod β
+  BigInt::limb_type mod_neg_inv;
+
+  // R mod N, where R = β^limb_count, which is 1 in Montgomery form
+  BigInt montgomery_one;
+
+  // R^2 mod N, which converts into Montgomery form
   BigInt conversion_factor;
 
+  // VectorMontgomery's kernels when the CPU has a vector unit that beats the
+  // scalar kernels at this size, then FixedBigInt's when limb_count is one of
+  // the sizes it's specialised for, otherwise BigInt's
+  multiply_kernel_type multiply_kernel;
+  square_kernel_type square_kernel;
+
+  // The modulus in the form the kernels take it, prepared once here
+  BigInt::limbs_type kernel_mod;
+
+  template <class Kernels> void use_kernels();
+  void select_kernels();
+
+  // A base raised to a power through this factory, and its table once it
+  // has been used more than once. The cache hands entries out as const, so
+  // the use count and the table, built once outside the cache's lock, are
+  // mutable.
+  struct FixedBaseEntry {
+    mutable std::atomic<unsigned long> uses;
+    mutable std::once_flag built;
+    mutable std::shared_ptr<const FixedBase> fixed_base;
+
+    FixedBaseEntry(const BigInt &base);
+  };
+
+  typedef LruCache<BigInt, FixedBaseEntry> FixedBaseCache;
+
+  // Looked up by fixed_base_pow, which is const like every other way of
+  // using a factory
+  mutable FixedBaseCache fixed_bases;
+
 public:
   ModIntFactory(const BigInt &modulus);
 
   ModInt create_int(const BigInt &value) const;
 
+  // 1, already in Montgomery form
+  ModInt one() const;
+
+  // x^-1, which throws if x isn't coprime to the modulus
+  ModInt inverse(const ModInt &x) const;
+
+  // The inverse of every value, using one inversion and 3(k - 1)
+  // multiplications for k values (Montgomery's trick). If any value has no
+  // inverse this throws, without saying which.
+  std::vector<ModInt> inverse(const std::vector<ModInt> &values) const;
+
+  // The most bases, and so tables, kept for fixed_base_pow
+  static const size_t FIXED_BASE_CAPACITY = 8;
+
+  // calculate base^n, where n has at most exponent_bits bits. A base that
+  // recurs gets a FixedBase table on its second use, which later calls reuse.
+  ModInt fixed_base_pow(const BigInt &base, const BigInt &n,
+                        BigInt::bit_index_type exponent_bits) const;
+
   friend class ModInt;
 };
 
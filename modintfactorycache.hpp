@@ -0,0 +1,9 @@
+#pragma once
+
+#include "bigint.hpp"
+#include "lrucache.hpp"
+#include "modintfactory.hpp"
+
+// Factories keyed by modulus, so that records sharing a modulus share its
+// Montgomery context
+typedef LruCache<BigInt, ModIntFactory> ModIntFactoryCache;
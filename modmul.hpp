@@ -1,22 +1,85 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <iterator>
+#include <memory>
 
 #include "bigint.hpp"
+#include "binaryrecords.hpp"
+#include "elgamalkey.hpp"
+#include "keygenerator.hpp"
 #include "modint.hpp"
+#include "modintfactorycache.hpp"
 #include "randint.hpp"
+#include "recordinput.hpp"
+#include "recordoutput.hpp"
+#include "recordpipeline.hpp"
+#include "rsacrtkey.hpp"
+#include "taskscheduler.hpp"
 
-using std::cin;
+using std::cerr;
 using std::cout;
 using std::endl;
 
-void repeat_stage(void (*stage)());
+// Enough for every modulus of a few keys to stay cached across records
+const ModIntFactoryCache::size_type FACTORY_CACHE_CAPACITY = 16;
 
-void stage1();
-void stage2();
-void stage3();
-void stage4();
+// Private keys decrypted under in stage2, with their CRT state precomputed
+typedef LruCache<RsaCrtKey::parameters_type, RsaCrtKey> RsaCrtKeyCache;
+
+const RsaCrtKeyCache::size_type KEY_CACHE_CAPACITY = 8;
+
+// Public keys encrypted under in stage3, each with its pool of random pads
+typedef LruCache<ElGamalKey::parameters_type, ElGamalKey> ElGamalKeyCache;
+
+const ElGamalKeyCache::size_type ELGAMAL_KEY_CACHE_CAPACITY = 8;
+
+// A stage, with the arity of its records and of its results
+struct StageInfo {
+  const char *name;
+  size_t arity;
+  size_t result_arity;
+  RecordPipeline::stage_type stage;
+};
+
+// Whether secret_pow hides the exponent from timing
+extern bool constant_time;
+
+// Whether stage2 blinds ciphertexts before decrypting them
+extern bool blind;
+
+// x^n, where n is a private key
+ModInt secret_pow(const ModInt &x, const BigInt &n);
+
+std::unique_ptr<RecordInput> open_input(const char *input_path);
+
+// Run a stage over every record, reading and writing them in format
+void repeat_stage(BinaryRecords::field_type tag, const StageInfo &info,
+                  unsigned int threads, const char *input_path,
+                  RecordPipeline::Format format);
+
+// The stage run by the converters
+void copy_record(const RecordPipeline::record_type &record,
+                 RecordPipeline::record_type &results);
+
+// Convert records to format to, from the other format
+void convert_records(RecordPipeline::Format to, BinaryRecords::field_type tag,
+                     BinaryRecords::field_type arity, unsigned int threads,
+                     const char *input_path);
+
+// Write each value of a generated key on a line of its own
+void write_key(const KeyGenerator::key_type &key);
+
+void stage1(const RecordPipeline::record_type &record,
+            RecordPipeline::record_type &results);
+void stage2(const RecordPipeline::record_type &record,
+            RecordPipeline::record_type &results);
+void stage3(const RecordPipeline::record_type &record,
+            RecordPipeline::record_type &results);
+void stage4(const RecordPipeline::record_type &record,
+            RecordPipeline::record_type &results);
 
 int main(int argc, char *argv[]);
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "lockfreering.hpp"
+#include "taskscheduler.hpp"
+
+// Pads computed ahead of time, such as the random exponentiations of an
+// encryption, so that the online path only has to pick one up. Pads are made
+// ahead by refill tasks on the TaskScheduler of the thread taking them, from
+// the second take on, so a pool that's used once costs nothing. A refill stays
+// a lead ahead of the takers that doubles whenever they find the pool empty,
+// up to the capacity. Takes off a worker thread, as in a single threaded run,
+// never refill, so they draw the same random numbers on every run. A take
+// from an empty pool computes its pad inline, so generate is called from the
+// refills and the takers alike, and must not throw.
+template <class Pad> class PadPool {
+public:
+  typedef std::unique_ptr<Pad> pad_pointer_type;
+  typedef std::function<Pad()> generator_type;
+
+  static const size_t INITIAL_LEAD = 4;
+
+private:
+  // Shared with the refill task, which may still be queued once the pool is
+  // destroyed, and then has to find out without touching the pool
+  struct Refill {
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    // At most one refill is submitted at a time, so only it pushes
+    bool submitted;
+    bool running;
+    bool cancelled;
+
+    Refill();
+  };
+
+  const generator_type generate;
+  const size_t capacity;
+
+  LockFreeRing<pad_pointer_type> ring;
+
+  std::atomic<size_t> available;
+  std::atomic<size_t> lead;
+  std::atomic<unsigned long> takes;
+
+  const std::shared_ptr<Refill> refill;
+
+  void request_refill(TaskScheduler &scheduler);
+  static void run_refill(PadPool *pool, const std::shared_ptr<Refill> &refill);
+
+public:
+  // capacity must be a power of two
+  PadPool(size_t capacity, generator_type generate);
+
+  // Waits for a running refill to finish its current pad
+  ~PadPool();
+
+  PadPool(const PadPool &) = delete;
+  PadPool &operator=(const PadPool &) = delete;
+
+  pad_pointer_type take();
+};
+
+template <class Pad>
+PadPool<Pad>::Refill::Refill()
+    : submitted(false), running(false), cancelled(false) {}
+
+template <class Pad>
+PadPool<Pad>::PadPool(size_t capacity, generator_type generate)
+    : generate(generate), capacity(capacity), ring(capacity), available(0),
+      lead(std::min(INITIAL_LEAD, capacity)), takes(0),
+      refill(std::make_shared<Refill>()) {}
+
+template <class Pad> PadPool<Pad>::~PadPool() {
+  std::unique_lock<std::mutex> lock(refill->mutex);
+  refill->cancelled = true;
+  refill->finished.wait(lock, [this] { return !refill->running; });
+}
+
+template <class Pad>
+void PadPool<Pad>::request_refill(TaskScheduler &scheduler) {
+  {
+    std::lock_guard<std::mutex> lock(refill->mutex);
+
+    if (refill->submitted) {
+      return;
+    }
+
+    refill->submitted = true;
+  }
+
+  scheduler.submit(std::bind(&PadPool::run_refill, this, refill));
+}
+
+template <class Pad>
+void PadPool<Pad>::run_refill(PadPool *pool,
+                              const std::shared_ptr<Refill> &refill) {
+  {
+    std::lock_guard<std::mutex> lock(refill->mutex);
+
+    // The pool is gone
+    if (refill->cancelled) {
+      return;
+    }
+
+    refill->running = true;
+  }
+
+  TaskScheduler *scheduler = TaskScheduler::current();
+
+  while (pool->available < pool->lead && !scheduler->is_stopping()) {
+    // There's room, as only this task pushes and it stays below capacity
+    pool->ring.try_push(pad_pointer_type(new Pad(pool->generate())));
+    ++pool->available;
+
+    std::lock_guard<std::mutex> lock(refill->mutex);
+
+    if (refill->cancelled) {
+      break;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(refill->mutex);
+  refill->submitted = false;
+  refill->running = false;
+  refill->finished.notify_all();
+}
+
+template <class Pad>
+typename PadPool<Pad>::pad_pointer_type PadPool<Pad>::take() {
+  pad_pointer_type pad;
+
+  if (ring.try_pop(pad)) {
+    --available;
+  } else {
+    size_t current_lead = lead;
+
+    if (current_lead < capacity) {
+      lead.compare_exchange_strong(current_lead, 2 * current_lead);
+    }
+
+    pad.reset(new Pad(generate()));
+  }
+
+  TaskScheduler *scheduler = TaskScheduler::current();
+
+  if (++takes > 1 && scheduler != nullptr && available < lead) {
+    request_refill(*scheduler);
+  }
+
+  return pad;
+}
@@ -0,0 +1,285 @@
+#include "primegenerator.hpp"
+
+const std::vector<BigInt::limb_type> &PrimeGenerator::small_primes() {
+  static const std::vector<BigInt::limb_type> primes = [] {
+    std::vector<bool> composite(SIEVE_LIMIT);
+    std::vector<BigInt::limb_type> odd_primes;
+
+    for (BigInt::limb_type n = 3; n < SIEVE_LIMIT; n += 2) {
+      if (!composite[n]) {
+        odd_primes.push_back(n);
+
+        for (BigInt::limb_type multiple = n * n; multiple < SIEVE_LIMIT;
+             multiple += 2 * n) {
+          composite[multiple] = true;
+        }
+      }
+    }
+
+    return odd_primes;
+  }();
+
+  return primes;
+}
+
+BigInt::limb_type PrimeGenerator::mod_limb(const BigInt &n,
+                                           BigInt::limb_type d) {
+  BigInt::limbs_const_iter_type limbs = n.least_significant_limb();
+  BigInt::limb_type remainder = 0;
+
+  for (BigInt::limbs_index_type i = n.significant_limb_count(); i-- > 0;) {
+    BigInt::double_limb_type value =
+        (static_cast<BigInt::double_limb_type>(remainder)
+         << BigInt::LIMB_WIDTH) |
+        limbs[i];
+
+    remainder = static_cast<BigInt::limb_type>(value % d);
+  }
+
+  return remainder;
+}
+
+bool PrimeGenerator::has_small_factor(const BigInt &n) {
+  for (BigInt::limb_type prime : small_primes()) {
+    if (mod_limb(n, prime) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// https://en.wikipedia.org/wiki/Miller%E2%80%93Rabin_primality_test
+bool PrimeGenerator::miller_rabin(const BigInt &n, unsigned int rounds) {
+  ModIntFactory factory(n);
+
+  BigInt n_minus_one = n - 1;
+
+  // n - 1 = d 2^s, where d is odd
+  BigInt::bit_index_type s = 0;
+
+  while (n_minus_one.window(s, 1) == 0) {
+    ++s;
+  }
+
+  BigInt d = n_minus_one;
+  d >>= BigInt::Bits(s);
+
+  // Every round raises to d
+  WindowedExponent d_windows(d);
+
+  ModInt x = factory.one();
+
+  for (unsigned int round = 0; round < rounds; ++round) {
+    BigInt base =
+        round == 0 ? BigInt(2) : random_bigint(BigInt(2), n_minus_one);
+
+    ModInt::pow(x, factory.create_int(base), d_windows);
+
+    BigInt y = static_cast<BigInt>(x);
+
+    if (y == 1 || y == n_minus_one) {
+      continue;
+    }
+
+    // base is a witness that n is composite unless squaring reaches -1
+    bool witness = true;
+
+    for (BigInt::bit_index_type i = 1; i < s && witness; ++i) {
+      x = x.square();
+      y = static_cast<BigInt>(x);
+
+      if (y == n_minus_one) {
+        witness = false;
+      } else if (y == 1) {
+        break;
+      }
+    }
+
+    if (witness) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool PrimeGenerator::search(BigInt::bit_index_type bits, bool safe,
+                            std::atomic<bool> &found, BigInt &prime) {
+  const std::vector<BigInt::limb_type> &primes = small_primes();
+
+  // The candidate c is the prime, or q for the safe prime 2q + 1
+  BigInt::bit_index_type candidate_bits = safe ? bits - 1 : bits;
+
+  BigInt top(1);
+  top <<= BigInt::Bits(candidate_bits - 1);
+
+  BigInt limit = top;
+  limit <<= BigInt::Bits(1);
+
+  // The smallest start, with the top bit set, and the next one too unless
+  // the prime is safe
+  BigInt floor = top;
+
+  if (!safe) {
+    BigInt next = top;
+    next >>= BigInt::Bits(1);
+    floor += next;
+  }
+
+  std::vector<BigInt::limb_type> residues(primes.size());
+  std::vector<char> composite(SIEVE_WINDOW);
+
+  while (!found) {
+    BigInt start = floor + random_bigint(limit - floor);
+
+    if (start.least_significant_limb_value() % 2 == 0) {
+      start += 1;
+    }
+
+    for (size_t i = 0; i < primes.size(); ++i) {
+      residues[i] = mod_limb(start, primes[i]);
+    }
+
+    // Sieve windows of candidates start + 2j until one runs past limit
+    for (bool in_range = true; in_range && !found;) {
+      std::fill(composite.begin(), composite.end(), 0);
+
+      for (size_t i = 0; i < primes.size(); ++i) {
+        BigInt::limb_type prime = primes[i], residue = residues[i];
+        BigInt::limb_type half = (prime + 1) / 2;
+
+        // The first j with residue + 2j = 0 mod prime, dividing by 2 as
+        // multiplying by half
+        BigInt::limb_type j = (prime - residue) % prime * half % prime;
+
+        for (; j < SIEVE_WINDOW; j += prime) {
+          composite[j] = 1;
+        }
+
+        // And with 2(residue + 2j) + 1 = 0, when 2c + 1 must be prime too
+        if (safe) {
+          j = ((prime - 1) / 2 + prime - residue) % prime * half % prime;
+
+          for (; j < SIEVE_WINDOW; j += prime) {
+            composite[j] = 1;
+          }
+        }
+      }
+
+      for (size_t j = 0; j < SIEVE_WINDOW && !found; ++j) {
+        if (composite[j]) {
+          continue;
+        }
+
+        BigInt candidate = start;
+        candidate += 2 * j;
+
+        if (candidate >= limit) {
+          in_range = false;
+          break;
+        }
+
+        bool is_prime;
+
+        if (safe) {
+          BigInt safe_candidate = candidate * 2;
+          safe_candidate += 1;
+
+          // A single round throws out almost every composite, so do one on
+          // each before finishing either
+          is_prime =
+              miller_rabin(candidate, 1) && miller_rabin(safe_candidate, 1) &&
+              miller_rabin(candidate, miller_rabin_rounds(candidate_bits)) &&
+              miller_rabin(safe_candidate, miller_rabin_rounds(bits));
+
+          candidate = safe_candidate;
+        } else {
+          is_prime = miller_rabin(candidate, miller_rabin_rounds(bits));
+        }
+
+        bool first = false;
+
+        if (is_prime && found.compare_exchange_strong(first, true)) {
+          prime = candidate;
+          return true;
+        }
+      }
+
+      start += 2 * SIEVE_WINDOW;
+
+      for (size_t i = 0; i < primes.size(); ++i) {
+        residues[i] = (residues[i] + 2 * SIEVE_WINDOW) % primes[i];
+      }
+    }
+  }
+
+  return false;
+}
+
+BigInt PrimeGenerator::parallel_search(BigInt::bit_index_type bits, bool safe,
+                                       unsigned int threads) {
+  std::atomic<bool> found(false);
+  BigInt prime;
+
+  std::vector<std::thread> workers;
+
+  for (unsigned int thread = 1; thread < threads; ++thread) {
+    workers.emplace_back([&] { search(bits, safe, found, prime); });
+  }
+
+  search(bits, safe, found, prime);
+
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+
+  return prime;
+}
+
+unsigned int
+PrimeGenerator::miller_rabin_rounds(BigInt::bit_index_type bits) {
+  const BigInt::bit_index_type min_bits[] = {1300, 850, 650, 550, 450, 400,
+                                             350,  300, 250, 200, 150};
+  const unsigned int rounds[] = {2, 3, 4, 5, 6, 7, 8, 9, 12, 15, 18};
+
+  for (size_t i = 0; i < sizeof(rounds) / sizeof(rounds[0]); ++i) {
+    if (bits >= min_bits[i]) {
+      return rounds[i];
+    }
+  }
+
+  return 27;
+}
+
+bool PrimeGenerator::is_probable_prime(const BigInt &n) {
+  if (n < SIEVE_LIMIT) {
+    BigInt::limb_type value = n.least_significant_limb_value();
+
+    return value == 2 || std::binary_search(small_primes().cbegin(),
+                                            small_primes().cend(), value);
+  } else if (n.least_significant_limb_value() % 2 == 0 ||
+             has_small_factor(n)) {
+    return false;
+  }
+
+  return miller_rabin(n, miller_rabin_rounds(n.log_2()));
+}
+
+BigInt PrimeGenerator::random_prime(BigInt::bit_index_type bits,
+                                    unsigned int threads) {
+  if (bits < MIN_BITS) {
+    throw invalid_argument("too few bits for a random prime");
+  }
+
+  return parallel_search(bits, false, threads);
+}
+
+BigInt PrimeGenerator::random_safe_prime(BigInt::bit_index_type bits,
+                                         unsigned int threads) {
+  if (bits <= MIN_BITS) {
+    throw invalid_argument("too few bits for a random safe prime");
+  }
+
+  return parallel_search(bits, true, threads);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bigint.hpp"
+#include "modint.hpp"
+#include "modintfactory.hpp"
+#include "randint.hpp"
+#include "windowedexponent.hpp"
+
+// Random probable primes, found by sieving a run of odd candidates from a
+// random start against a table of small primes, then testing the survivors
+// with Miller-Rabin in a Montgomery context. The residues of the start are
+// found once per search and stepped along from window to window, so no
+// candidate is divided by the small primes from scratch. Searches run on
+// several threads at once from different starts, and the first to find a
+// prime wins.
+class PrimeGenerator {
+public:
+  // Candidates must be larger than every prime in the table, see SIEVE_LIMIT
+  static const BigInt::bit_index_type MIN_BITS = 16;
+
+private:
+  // The table holds the odd primes below this
+  static const BigInt::limb_type SIEVE_LIMIT = 1 << 13;
+
+  // The number of odd candidates sieved at a time
+  static const size_t SIEVE_WINDOW = 1 << 12;
+
+  // The odd primes below SIEVE_LIMIT, by the sieve of Eratosthenes
+  static const std::vector<BigInt::limb_type> &small_primes();
+
+  static BigInt::limb_type mod_limb(const BigInt &n, BigInt::limb_type d);
+
+  static bool has_small_factor(const BigInt &n);
+
+  // rounds rounds of Miller-Rabin, the first to base 2 and the rest to
+  // random bases
+  static bool miller_rabin(const BigInt &n, unsigned int rounds);
+
+  // Search from random starts for a prime of bits bits, or a safe prime
+  // 2q + 1 of bits bits, until one is found here or found is set elsewhere.
+  // The two top bits of a prime that isn't safe are set, so that the
+  // product of two has exactly twice as many bits.
+  static bool search(BigInt::bit_index_type bits, bool safe,
+                     std::atomic<bool> &found, BigInt &prime);
+
+  static BigInt parallel_search(BigInt::bit_index_type bits, bool safe,
+                                unsigned int threads);
+
+public:
+  // Rounds of Miller-Rabin for an error below 2^-80 on a random candidate
+  // of bits bits, from table 4.4 of the Handbook of Applied Cryptography
+  static unsigned int miller_rabin_rounds(BigInt::bit_index_type bits);
+
+  // Whether n is prime, with an error below 2^-80 for random n
+  static bool is_probable_prime(const BigInt &n);
+
+  // A random prime of bits bits, with its top two bits set
+  static BigInt random_prime(BigInt::bit_index_type bits,
+                             unsigned int threads = 1);
+
+  // A random p = 2q + 1 of bits bits, where p and q are both prime
+  static BigInt random_safe_prime(BigInt::bit_index_type bits,
+                                  unsigned int threads = 1);
+};
@@ -1,26 +1,45 @@
 #include "randint.hpp"
 
 void seed_generator() {
-  unsigned int seed;
+  ChaCha20::key_type key;
 
-  ifstream dev_random("/dev/random");
+  ifstream urandom("/dev/urandom", ifstream::binary);
 
-  dev_random.read(reinterpret_cast<char *>(&seed), sizeof(seed));
+  urandom.read(reinterpret_cast<char *>(key), sizeof(key));
 
-  dev_random.close();
+  if (!urandom) {
+    throw runtime_error("cannot read a seed from /dev/urandom");
+  }
+
+  ChaCha20::seed(key);
+}
+
+void seed_generator(uint64_t seed) {
+  ChaCha20::key_type key = {static_cast<uint32_t>(seed),
+                            static_cast<uint32_t>(seed >> 32)};
 
-  srand(seed);
+  ChaCha20::seed(key);
 }
 
-BigInt::limb_type random_limb() { return rand() & BigInt::LIMB_MASK; }
+void random_limbs(BigInt::limb_type *out, BigInt::limbs_size_type count) {
+  ChaCha20::local().fill(out, count);
+}
+
+BigInt::limb_type random_limb() {
+  BigInt::limb_type limb;
+  random_limbs(&limb, 1);
+
+  return limb;
+}
 
 BigInt::limb_type random_limb(BigInt::limb_type range) {
-  BigInt::limb_type range_mask = 1;
+  // All ones up to the highest bit of range - 1
+  BigInt::limb_type range_mask = range - 1;
 
-  while (range_mask < range) {
-    range_mask <<= 1;
+  for (BigInt::bit_count_type shift = 1; shift < BigInt::LIMB_WIDTH;
+       shift *= 2) {
+    range_mask |= range_mask >> shift;
   }
-  --range_mask;
 
   BigInt::limb_type limb;
 
@@ -36,17 +55,26 @@ BigInt random_bigint(const BigInt &range) {
     throw range_error("RNG range cannot be zero");
   }
 
+  // Draw as many bits as range - 1 has until the number is below range,
+  // which takes fewer than two draws on average
+  BigInt::bit_index_type bits = (range - 1).log_2();
+
+  BigInt::limbs_type limbs((bits + BigInt::LIMB_WIDTH - 1) /
+                           BigInt::LIMB_WIDTH);
+
   BigInt result;
 
-  BigInt::limbs_const_iter_type most_significant_limb =
-      range.most_significant_limb();
+  do {
+    random_limbs(limbs.data(), limbs.size());
 
-  for (BigInt::limbs_const_iter_type limb_iter = range.least_significant_limb();
-       limb_iter != most_significant_limb; ++limb_iter) {
-    result.append_limb(random_limb());
-  }
+    if (bits % BigInt::LIMB_WIDTH != 0) {
+      limbs.back() &=
+          (static_cast<BigInt::limb_type>(1) << (bits % BigInt::LIMB_WIDTH)) -
+          1;
+    }
 
-  result.append_limb(random_limb(*most_significant_limb));
+    result.assign(limbs.cbegin(), limbs.cend());
+  } while (result >= range);
 
   return result;
 }
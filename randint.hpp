@@ -1,22 +1,34 @@
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <string>
 
 #include "bigint.hpp"
+#include "chacha20.hpp"
 
 using std::ifstream;
+using std::runtime_error;
 
 #define FIX_KEY
 
+// Seed every thread's generator from the operating system
 void seed_generator();
 
+// Seed every thread's generator from seed, so that a single thread draws the
+// same numbers on every run
+void seed_generator(uint64_t seed);
+
+// Fill out with count random limbs
+void random_limbs(BigInt::limb_type *out, BigInt::limbs_size_type count);
+
 BigInt::limb_type random_limb();
 
 BigInt::limb_type random_limb(BigInt::limb_type range);
 
+// A uniformly random integer in [0, range)
 BigInt random_bigint(const BigInt &range);
 
 BigInt random_bigint(const BigInt &lower, const BigInt &upper);
@@ -0,0 +1,142 @@
+#include "recordinput.hpp"
+
+RecordInput::RecordInput(int fd)
+    : fd(fd), owns_fd(false), mapping(nullptr), mapping_size(0),
+      position(nullptr), data_end(nullptr), finished(false) {
+  open_data();
+}
+
+RecordInput::RecordInput(const string &path)
+    : fd(open(path.c_str(), O_RDONLY)), owns_fd(true), mapping(nullptr),
+      mapping_size(0), position(nullptr), data_end(nullptr), finished(false) {
+  if (fd < 0) {
+    throw runtime_error("cannot open " + path + ": " + strerror(errno));
+  }
+
+  open_data();
+}
+
+RecordInput::~RecordInput() {
+  if (mapping != nullptr) {
+    munmap(mapping, mapping_size);
+  }
+
+  if (owns_fd) {
+    close(fd);
+  }
+}
+
+bool RecordInput::is_space(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' ||
+         c == '\f';
+}
+
+void RecordInput::open_data() {
+  struct stat status;
+
+  if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode) &&
+      status.st_size > 0) {
+    void *address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (address != MAP_FAILED) {
+      mapping = static_cast<char *>(address);
+      mapping_size = status.st_size;
+
+      madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+      position = mapping;
+      data_end = mapping + mapping_size;
+      finished = true;
+      return;
+    }
+  }
+
+  // Not something that can be mapped, so fall back to reading blocks
+  buffer.resize(BLOCK_SIZE);
+  position = data_end = buffer.data();
+}
+
+bool RecordInput::refill(const char *&keep) {
+  if (finished) {
+    return false;
+  }
+
+  size_t kept = data_end - keep, position_offset = position - keep;
+  memmove(buffer.data(), keep, kept);
+
+  // A token longer than the buffer needs more room
+  if (kept == buffer.size()) {
+    buffer.resize(2 * buffer.size());
+  }
+
+  ssize_t count;
+
+  do {
+    count = read(fd, buffer.data() + kept, buffer.size() - kept);
+  } while (count < 0 && errno == EINTR);
+
+  if (count < 0) {
+    throw runtime_error(string("cannot read input: ") + strerror(errno));
+  }
+
+  keep = buffer.data();
+  position = buffer.data() + position_offset;
+  data_end = buffer.data() + kept + count;
+
+  if (count == 0) {
+    finished = true;
+  }
+
+  return count > 0;
+}
+
+bool RecordInput::next_token(const char *&start, const char *&end) {
+  while (true) {
+    while (position != data_end && is_space(*position)) {
+      ++position;
+    }
+
+    if (position != data_end) {
+      break;
+    }
+
+    const char *keep = data_end;
+
+    if (!refill(keep)) {
+      return false;
+    }
+  }
+
+  const char *token = position;
+
+  while (true) {
+    while (position != data_end && !is_space(*position)) {
+      ++position;
+    }
+
+    // A token running to the end of the buffer may continue in the next block
+    if (position != data_end || !refill(token)) {
+      break;
+    }
+  }
+
+  start = token;
+  end = position;
+
+  return true;
+}
+
+bool RecordInput::next_bytes(size_t count, const char *&start) {
+  while (static_cast<size_t>(data_end - position) < count) {
+    const char *keep = position;
+
+    if (!refill(keep)) {
+      return false;
+    }
+  }
+
+  start = position;
+  position += count;
+
+  return true;
+}
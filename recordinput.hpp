@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using std::runtime_error;
+using std::string;
+
+// Splits a file into whitespace separated tokens, or fixed size runs of bytes,
+// without copying them. Regular files are memory mapped, and anything else,
+// such as a pipe, is read in large blocks.
+class RecordInput {
+private:
+  static const size_t BLOCK_SIZE = 1 << 20;
+
+  const int fd;
+  const bool owns_fd;
+
+  // The mapped file, or nullptr when reading into buffer
+  char *mapping;
+  size_t mapping_size;
+
+  std::vector<char> buffer;
+
+  // The unread part of the mapping or buffer
+  const char *position;
+  const char *data_end;
+
+  // Whether there is nothing left to read into buffer
+  bool finished;
+
+  static bool is_space(char c);
+
+  void open_data();
+
+  // Read another block, keeping the data from keep onwards and updating keep
+  // to where it was moved. Returns false when nothing more could be read.
+  bool refill(const char *&keep);
+
+public:
+  // Tokenize an already open file, such as stdin
+  RecordInput(int fd);
+  RecordInput(const string &path);
+
+  RecordInput(const RecordInput &) = delete;
+  RecordInput &operator=(const RecordInput &) = delete;
+
+  ~RecordInput();
+
+  // Find the next token, returning false at the end of the input. The token
+  // stays valid until the next call.
+  bool next_token(const char *&start, const char *&end);
+
+  // Find the next count bytes, returning false if there are fewer left. The
+  // bytes stay valid until the next call.
+  bool next_bytes(size_t count, const char *&start);
+};
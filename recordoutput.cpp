@@ -0,0 +1,76 @@
+#include "recordoutput.hpp"
+
+RecordOutput::RecordOutput(int fd) : fd(fd), buffer(BLOCK_SIZE) {
+  setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+RecordOutput::~RecordOutput() {
+  try {
+    write_buffer();
+  } catch (const runtime_error &) {
+    // Nothing can be reported from a destructor
+  }
+}
+
+void RecordOutput::write_all(const char *start, const char *end) {
+  while (start != end) {
+    ssize_t count = write(fd, start, end - start);
+
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      throw runtime_error(string("cannot write output: ") + strerror(errno));
+    }
+
+    start += count;
+  }
+}
+
+void RecordOutput::write_buffer() {
+  const char *start = pbase(), *end = pptr();
+
+  // Reset first, so a failed write doesn't leave the data to be written again
+  setp(buffer.data(), buffer.data() + buffer.size());
+
+  write_all(start, end);
+}
+
+RecordOutput::int_type RecordOutput::overflow(int_type c) {
+  write_buffer();
+
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+
+  return traits_type::not_eof(c);
+}
+
+std::streamsize RecordOutput::xsputn(const char *s, std::streamsize count) {
+  if (count > epptr() - pptr()) {
+    write_buffer();
+
+    // Too big to be worth buffering at all
+    if (count >= static_cast<std::streamsize>(buffer.size())) {
+      write_all(s, s + count);
+      return count;
+    }
+  }
+
+  memcpy(pptr(), s, count);
+  pbump(count);
+
+  return count;
+}
+
+int RecordOutput::sync() {
+  try {
+    write_buffer();
+  } catch (const runtime_error &) {
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using std::runtime_error;
+using std::string;
+
+// A stream buffer that collects output in one large block and writes it to a
+// file descriptor when full, so writing a record is a copy rather than a
+// system call
+class RecordOutput : public std::streambuf {
+private:
+  static const size_t BLOCK_SIZE = 1 << 20;
+
+  const int fd;
+
+  std::vector<char> buffer;
+
+  // Write all of [start, end) to fd
+  void write_all(const char *start, const char *end);
+
+  // Write everything buffered so far
+  void write_buffer();
+
+protected:
+  int_type overflow(int_type c);
+  std::streamsize xsputn(const char *s, std::streamsize count);
+  int sync();
+
+public:
+  RecordOutput(int fd);
+
+  RecordOutput(const RecordOutput &) = delete;
+  RecordOutput &operator=(const RecordOutput &) = delete;
+
+  ~RecordOutput();
+};
@@ -0,0 +1,138 @@
+#include "recordpipeline.hpp"
+
+RecordPipeline::RecordPipeline(size_t arity, stage_type stage,
+                               unsigned int thread_count, Format input_format,
+                               Format output_format)
+    : arity(arity), stage(stage), thread_count(thread_count),
+      input_format(input_format), output_format(output_format),
+      max_in_flight(4 * static_cast<sequence_type>(thread_count)),
+      read_count(0), written_count(0), reading_finished(false) {
+  if (thread_count == 0) {
+    throw invalid_argument("pipeline needs at least one thread");
+  }
+}
+
+bool RecordPipeline::read_record(RecordInput &in,
+                                 record_type &record) const {
+  record.resize(arity);
+
+  for (BigInt &value : record) {
+    if (input_format == BINARY) {
+      if (!BinaryRecords::read_value(in, value)) {
+        return false;
+      }
+    } else {
+      const char *start, *end;
+
+      if (!in.next_token(start, end)) {
+        return false;
+      }
+
+      value.assign_hex(start, end);
+    }
+  }
+
+  return true;
+}
+
+void RecordPipeline::write_results(ostream &out,
+                                   const record_type &results) const {
+  for (const BigInt &value : results) {
+    if (output_format == BINARY) {
+      BinaryRecords::write_value(out, value);
+    } else {
+      out << value << '\n';
+    }
+  }
+}
+
+void RecordPipeline::read_all(RecordInput &in, TaskScheduler &scheduler) {
+  record_type record;
+
+  while (read_record(in, record)) {
+    sequence_type sequence;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+
+      result_written.wait(
+          lock, [this] { return read_count - written_count < max_in_flight; });
+
+      sequence = read_count++;
+    }
+
+    scheduler.submit(
+        std::bind(&RecordPipeline::process, this, sequence, record));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  reading_finished = true;
+  result_stored.notify_all();
+}
+
+void RecordPipeline::process(sequence_type sequence,
+                             const record_type &record) {
+  record_type record_results;
+  stage(record, record_results);
+
+  std::ostringstream out;
+  write_results(out, record_results);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  results[sequence] = out.str();
+  result_stored.notify_all();
+}
+
+void RecordPipeline::write_all(ostream &out) {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    result_stored.wait(lock, [this] {
+      return results.count(written_count) > 0 ||
+             (reading_finished && written_count == read_count);
+    });
+
+    auto result_iter = results.find(written_count);
+
+    if (result_iter == results.end()) {
+      break;
+    }
+
+    std::string result;
+    result.swap(result_iter->second);
+    results.erase(result_iter);
+
+    ++written_count;
+    result_written.notify_one();
+
+    lock.unlock();
+    out << result;
+    lock.lock();
+  }
+
+  out.flush();
+}
+
+void RecordPipeline::run(RecordInput &in, ostream &out) {
+  if (thread_count == 1) {
+    record_type record, results;
+
+    while (read_record(in, record)) {
+      results.clear();
+      stage(record, results);
+
+      write_results(out, results);
+    }
+
+    out.flush();
+  } else {
+    TaskScheduler scheduler(thread_count);
+
+    std::thread reader(&RecordPipeline::read_all, this, std::ref(in),
+                       std::ref(scheduler));
+
+    write_all(out);
+
+    reader.join();
+  }
+}
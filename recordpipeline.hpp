@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bigint.hpp"
+#include "binaryrecords.hpp"
+#include "recordinput.hpp"
+#include "taskscheduler.hpp"
+
+using std::ostream;
+
+// Runs a stage over every record of an input, either in order on the
+// calling thread, or with a reader thread, a TaskScheduler running the stage
+// on each record and an ordered writer. Either way the output is identical.
+class RecordPipeline {
+public:
+  typedef std::vector<BigInt> record_type;
+  typedef size_t sequence_type;
+
+  // Compute the results of one record, appending them to results
+  typedef void (*stage_type)(const record_type &record, record_type &results);
+
+  // How values are read and written, either as lines of hex or BinaryRecords
+  enum Format { HEX, BINARY };
+
+private:
+  const size_t arity;
+  const stage_type stage;
+  const unsigned int thread_count;
+  const Format input_format;
+  const Format output_format;
+
+  // The most records read but not yet written
+  const sequence_type max_in_flight;
+
+  std::mutex mutex;
+  // Signalled when a result is stored, or reading finishes
+  std::condition_variable result_stored;
+  // Signalled when a result is written
+  std::condition_variable result_written;
+
+  std::map<sequence_type, std::string> results;
+
+  sequence_type read_count;
+  sequence_type written_count;
+  bool reading_finished;
+
+  // Read a whole record, returning false at the end of the input
+  bool read_record(RecordInput &in, record_type &record) const;
+  void write_results(ostream &out, const record_type &results) const;
+
+  void read_all(RecordInput &in, TaskScheduler &scheduler);
+  void process(sequence_type sequence, const record_type &record);
+  void write_all(ostream &out);
+
+public:
+  RecordPipeline(size_t arity, stage_type stage, unsigned int thread_count,
+                 Format input_format = HEX, Format output_format = HEX);
+
+  void run(RecordInput &in, ostream &out);
+};
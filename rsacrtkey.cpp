@@ -0,0 +1,90 @@
+#include "rsacrtkey.hpp"
+
+RsaCrtKey::RsaCrtKey(const parameters_type &parameters)
+    : p(std::get<0>(parameters)), q(std::get<1>(parameters)),
+      d_p(std::get<2>(parameters)), d_q(std::get<3>(parameters)),
+      p_f(std::make_shared<ModIntFactory>(p)),
+      q_f(std::make_shared<ModIntFactory>(q)),
+      i_q_mod_p(std::get<4>(parameters) % *p_f), d_p_windows(d_p),
+      d_q_windows(d_q),
+      blinding_pads(BLINDING_PAD_CAPACITY,
+                    [this] { return generate_blinding_pad(); }) {}
+
+RsaCrtKey::BlindingPad RsaCrtKey::generate_blinding_pad() const {
+  std::call_once(public_exponents_found, [this] {
+    e_p = BigInt::mod_inv(d_p, p - 1);
+    e_q = BigInt::mod_inv(d_q, q - 1);
+  });
+
+  // p and q are prime, so every r in [1, p) and [1, q) has an inverse, and
+  // picking them apart picks r mod pq
+  ModInt r_mod_p = random_bigint(BigInt(1), p) % *p_f,
+         r_mod_q = random_bigint(BigInt(1), q) % *q_f;
+
+  return BlindingPad{r_mod_p.pow(e_p), p_f->inverse(r_mod_p),
+                     r_mod_q.pow(e_q), q_f->inverse(r_mod_q)};
+}
+
+BigInt RsaCrtKey::decrypt(const BigInt &c, bool constant_time,
+                          bool blind) const {
+  ModInt c_mod_p = c % *p_f, c_mod_q = c % *q_f;
+
+  PadPool<BlindingPad>::pad_pointer_type pad;
+
+  if (blind) {
+    pad = blinding_pads.take();
+
+    c_mod_p = c_mod_p * pad->r_e_mod_p;
+    c_mod_q = c_mod_q * pad->r_e_mod_q;
+  }
+
+  ModInt m1_mod_p = p_f->one(), m2_mod_q = q_f->one();
+
+  // The two halves are independent, so an idle worker can take one
+  TaskScheduler::fork_join(
+      // m1 = c^d_p mod p
+      [&] {
+        if (constant_time) {
+          ModInt::pow_constant_time(m1_mod_p, c_mod_p, d_p);
+        } else {
+          ModInt::pow(m1_mod_p, c_mod_p, d_p_windows);
+        }
+      },
+      // m2 = c^d_q mod q
+      [&] {
+        if (constant_time) {
+          ModInt::pow_constant_time(m2_mod_q, c_mod_q, d_q);
+        } else {
+          ModInt::pow(m2_mod_q, c_mod_q, d_q_windows);
+        }
+      });
+
+  if (blind) {
+    m1_mod_p = m1_mod_p * pad->r_inverse_mod_p;
+    m2_mod_q = m2_mod_q * pad->r_inverse_mod_q;
+  }
+
+  BigInt m1 = static_cast<BigInt>(m1_mod_p),
+         m2 = static_cast<BigInt>(m2_mod_q);
+
+  BigInt m2_mod_p = m2;
+  m2_mod_p %= p;
+
+  // m_diff = (m1 - m2) mod p, where m2 < q might not be below p
+  BigInt &m_diff = m1;
+
+  if (m_diff < m2_mod_p) {
+    m_diff += p;
+  }
+
+  m_diff -= m2_mod_p;
+
+  // h = i_q(m1 - m2) mod p
+  BigInt h = i_q_mod_p.multiply_plain(m_diff);
+
+  // m = m2 + h * q, which is already below N = pq as m2 < q and h < p
+  BigInt m = h * q;
+  m += m2;
+
+  return m;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include "bigint.hpp"
+#include "modint.hpp"
+#include "modintfactory.hpp"
+#include "padpool.hpp"
+#include "randint.hpp"
+#include "taskscheduler.hpp"
+#include "windowedexponent.hpp"
+
+// An RSA private key in CRT form, with everything that doesn't depend on the
+// ciphertext precomputed, so that decrypting under the same key again only
+// does the two exponentiations and the recombination.
+class RsaCrtKey {
+public:
+  // p, q, d_p, d_q and i_q = q^-1 mod p
+  typedef std::tuple<BigInt, BigInt, BigInt, BigInt, BigInt> parameters_type;
+
+  static const size_t BLINDING_PAD_CAPACITY = 64;
+
+private:
+  const BigInt p, q;
+  const BigInt d_p, d_q;
+
+  const std::shared_ptr<const ModIntFactory> p_f, q_f;
+
+  // i_q, in Montgomery form mod p
+  const ModInt i_q_mod_p;
+
+  const WindowedExponent d_p_windows, d_q_windows;
+
+  // r^e and r^-1 mod p and mod q for a random r, in Montgomery form.
+  // Decrypting c r^e gives m r, so the exponentiations never see c itself.
+  struct BlindingPad {
+    ModInt r_e_mod_p, r_inverse_mod_p, r_e_mod_q, r_inverse_mod_q;
+  };
+
+  // e mod p - 1 and e mod q - 1, the inverses of d_p and d_q, which are only
+  // found once a ciphertext is blinded
+  mutable std::once_flag public_exponents_found;
+  mutable BigInt e_p, e_q;
+
+  BlindingPad generate_blinding_pad() const;
+
+  // Filled and drained by decrypt, which is const as keys are shared
+  // between records through a cache of const keys
+  mutable PadPool<BlindingPad> blinding_pads;
+
+public:
+  RsaCrtKey(const parameters_type &parameters);
+
+  // c^d mod pq, without leaking d through timing if constant_time, and
+  // blinding c with a random pad first if blind
+  BigInt decrypt(const BigInt &c, bool constant_time, bool blind) const;
+};
@@ -0,0 +1,26 @@
+#include "scratcharena.hpp"
+
+ScratchArena::ScratchArena() : used(0) {}
+
+ScratchArena &ScratchArena::local() {
+  static thread_local ScratchArena arena;
+  return arena;
+}
+
+ScratchArena::Frame::Frame(ScratchArena &arena)
+    : arena(arena), mark(arena.used) {}
+
+ScratchArena::Frame::~Frame() { arena.used = mark; }
+
+BigInt::limbs_type &
+ScratchArena::Frame::acquire(BigInt::limbs_size_type size) {
+  if (arena.used == arena.buffers.size()) {
+    arena.buffers.emplace_back();
+  }
+
+  BigInt::limbs_type &buffer = arena.buffers[arena.used++];
+  // Only reallocates when the buffer has never been this large
+  buffer.resize(size);
+
+  return buffer;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+
+#include "bigint.hpp"
+
+// Limb buffers that are kept between calls on the same thread, so a
+// calculation that takes its working storage from here only allocates while
+// the buffers are first growing. Buffers are handed out and given back in
+// stack order through Frames.
+class ScratchArena {
+private:
+  // A deque never moves its elements, so handed out buffers stay valid
+  std::deque<BigInt::limbs_type> buffers;
+  size_t used;
+
+  ScratchArena();
+
+public:
+  // The buffers acquired through a frame are returned when it goes out of
+  // scope
+  class Frame {
+  private:
+    ScratchArena &arena;
+    const size_t mark;
+
+  public:
+    Frame(ScratchArena &arena);
+    ~Frame();
+
+    Frame(const Frame &) = delete;
+    Frame &operator=(const Frame &) = delete;
+
+    // A buffer of size limbs, with undefined contents
+    BigInt::limbs_type &acquire(BigInt::limbs_size_type size);
+  };
+
+  // The arena of the calling thread
+  static ScratchArena &local();
+};
@@ -0,0 +1,199 @@
+#include "taskscheduler.hpp"
+
+thread_local TaskScheduler *TaskScheduler::current_scheduler = nullptr;
+thread_local size_t TaskScheduler::current_worker = 0;
+
+TaskScheduler::Job::Job(const task_type &task) : task(task), finished(false) {}
+
+void TaskScheduler::Job::run() {
+  try {
+    task();
+  } catch (...) {
+    exception = std::current_exception();
+  }
+
+  // Notifying under the lock keeps the job alive until done is signalled, as
+  // wait can't return and let fork_join destroy it before then
+  std::lock_guard<std::mutex> lock(mutex);
+  finished = true;
+  done.notify_one();
+}
+
+void TaskScheduler::Job::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [this] { return finished; });
+}
+
+TaskScheduler::TaskScheduler(unsigned int thread_count)
+    : stopping(false), queued_jobs(0) {
+  for (unsigned int n = 0; n < thread_count; ++n) {
+    deques.push_back(std::unique_ptr<WorkerDeque>(new WorkerDeque()));
+  }
+
+  for (size_t worker = 0; worker < thread_count; ++worker) {
+    threads.push_back(std::thread(&TaskScheduler::work, this, worker));
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+
+  work_available.notify_all();
+
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+void TaskScheduler::submit(const task_type &task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    submitted.push_back(task);
+  }
+
+  work_available.notify_one();
+}
+
+bool TaskScheduler::is_stopping() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return stopping;
+}
+
+TaskScheduler *TaskScheduler::current() { return current_scheduler; }
+
+void TaskScheduler::push_job(size_t worker, Job *job) {
+  {
+    std::lock_guard<std::mutex> lock(deques[worker]->mutex);
+    deques[worker]->jobs.push_back(job);
+  }
+
+  {
+    // Counting under the lock means a worker about to sleep can't miss it
+    std::lock_guard<std::mutex> lock(mutex);
+    ++queued_jobs;
+  }
+
+  work_available.notify_one();
+}
+
+bool TaskScheduler::reclaim_job(size_t worker, Job *job) {
+  std::lock_guard<std::mutex> lock(deques[worker]->mutex);
+
+  std::deque<Job *> &jobs = deques[worker]->jobs;
+
+  if (!jobs.empty() && jobs.back() == job) {
+    jobs.pop_back();
+    --queued_jobs;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+bool TaskScheduler::steal_job(size_t thief, Job *&job) {
+  for (size_t offset = 1; offset <= deques.size(); ++offset) {
+    WorkerDeque &victim = *deques[(thief + offset) % deques.size()];
+
+    std::lock_guard<std::mutex> lock(victim.mutex);
+
+    if (!victim.jobs.empty()) {
+      job = victim.jobs.front();
+      victim.jobs.pop_front();
+      --queued_jobs;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void TaskScheduler::work(size_t worker) {
+  current_scheduler = this;
+  current_worker = worker;
+
+  while (true) {
+    Job *job;
+
+    // Forked halves first, as they hold up a task that is already running
+    if (steal_job(worker, job)) {
+      job->run();
+    } else {
+      task_type task;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        work_available.wait(lock, [this] {
+          return !submitted.empty() || stopping || queued_jobs > 0;
+        });
+
+        if (!submitted.empty()) {
+          task.swap(submitted.front());
+          submitted.pop_front();
+        } else if (stopping && queued_jobs == 0) {
+          // Forks only come from running tasks, and those reclaim or wait
+          // on their own jobs, so nothing more can arrive
+          return;
+        }
+      }
+
+      if (task) {
+        task();
+      }
+    }
+  }
+}
+
+void TaskScheduler::fork_join(const task_type &first,
+                              const task_type &second) {
+  TaskScheduler *scheduler = current_scheduler;
+
+  if (scheduler == nullptr) {
+    first();
+    second();
+    return;
+  }
+
+  size_t worker = current_worker;
+
+  Job job(second);
+  scheduler->push_job(worker, &job);
+
+  std::exception_ptr first_exception;
+
+  try {
+    first();
+  } catch (...) {
+    first_exception = std::current_exception();
+  }
+
+  if (scheduler->reclaim_job(worker, &job)) {
+    job.run();
+  } else {
+    // Another worker has second, so help with other forked halves while
+    // there are any, rather than starting a whole new task, then sleep until
+    // it is done
+    Job *other_job;
+
+    while (scheduler->steal_job(worker, other_job)) {
+      other_job->run();
+
+      std::lock_guard<std::mutex> lock(job.mutex);
+
+      if (job.finished) {
+        break;
+      }
+    }
+
+    job.wait();
+  }
+
+  if (first_exception) {
+    std::rethrow_exception(first_exception);
+  } else if (job.exception) {
+    std::rethrow_exception(job.exception);
+  }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A pool of worker threads running submitted tasks. Tasks may split
+// themselves with fork_join, which leaves the second half on the worker's own
+// deque for an idle worker to steal. When every worker is busy nothing gets
+// stolen, and each worker simply runs both halves itself.
+class TaskScheduler {
+public:
+  typedef std::function<void()> task_type;
+
+private:
+  // A forked half of a task, which lives on the stack of fork_join
+  struct Job {
+    const task_type &task;
+
+    // Guards finished, and wakes fork_join when another worker finishes it
+    std::mutex mutex;
+    std::condition_variable done;
+    bool finished;
+
+    // Thrown by task, to be rethrown on the thread that forked it
+    std::exception_ptr exception;
+
+    Job(const task_type &task);
+
+    void run();
+    void wait();
+  };
+
+  // The owner pushes and pops at the back, thieves steal from the front
+  struct WorkerDeque {
+    std::mutex mutex;
+    std::deque<Job *> jobs;
+  };
+
+  std::vector<std::unique_ptr<WorkerDeque>> deques;
+  std::vector<std::thread> threads;
+
+  // Guards submitted and stopping, and lets idle workers sleep
+  std::mutex mutex;
+  std::condition_variable work_available;
+  std::deque<task_type> submitted;
+  bool stopping;
+
+  // The number of jobs on all the deques
+  std::atomic<long> queued_jobs;
+
+  // The scheduler and worker index of the calling thread, if it is a worker
+  static thread_local TaskScheduler *current_scheduler;
+  static thread_local size_t current_worker;
+
+  void push_job(size_t worker, Job *job);
+  // Take job back from the back of its owner's deque, unless it was stolen
+  bool reclaim_job(size_t worker, Job *job);
+  bool steal_job(size_t thief, Job *&job);
+
+  void work(size_t worker);
+
+public:
+  TaskScheduler(unsigned int thread_count);
+
+  // Finishes every submitted task before returning
+  ~TaskScheduler();
+
+  void submit(const task_type &task);
+
+  // Whether the scheduler is being destroyed, so that a task doing optional
+  // work ahead of time can stop early rather than hold up the destructor
+  bool is_stopping();
+
+  // The scheduler the calling thread is a worker of, or nullptr
+  static TaskScheduler *current();
+
+  // Run first and second, in parallel if the calling thread is a worker and
+  // another worker is free to take second. If either throws, the exception
+  // is rethrown here once both have finished.
+  static void fork_join(const task_type &first, const task_type &second);
+};
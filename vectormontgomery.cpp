@@ -0,0 +1,372 @@
+#include "vectormontgomery.hpp"
+
+bool VectorMontgomery::avx2_supported() {
+#if defined(__x86_64__)
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+bool VectorMontgomery::ifma_supported() {
+#if defined(__x86_64__)
+  static const bool supported = __builtin_cpu_supports("avx512f") &&
+                                __builtin_cpu_supports("avx512ifma");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+BigInt::limbs_size_type
+VectorMontgomery::digits_in(BigInt::limbs_size_type n,
+                            BigInt::bit_count_type digit_bits) {
+  return (n * BigInt::LIMB_WIDTH + digit_bits - 1) / digit_bits;
+}
+
+BigInt::limbs_size_type
+VectorMontgomery::padded_digits(BigInt::limbs_size_type digit_count,
+                                BigInt::limbs_size_type lanes) {
+  return (digit_count + 2 + lanes - 1) / lanes * lanes;
+}
+
+void VectorMontgomery::to_digits(BigInt::limbs_const_iter_type limbs,
+                                 BigInt::limbs_size_type n,
+                                 BigInt::limb_type *digits,
+                                 BigInt::limbs_size_type count,
+                                 BigInt::limbs_size_type padded_count,
+                                 BigInt::bit_count_type digit_bits) {
+  BigInt::limb_type mask =
+      (static_cast<BigInt::limb_type>(1) << digit_bits) - 1;
+
+  for (BigInt::limbs_index_type j = 0; j < count; ++j) {
+    BigInt::limbs_index_type position = j * digit_bits;
+    BigInt::limbs_index_type limb = position / BigInt::LIMB_WIDTH;
+    BigInt::bit_count_type shift = position % BigInt::LIMB_WIDTH;
+
+    BigInt::limb_type digit = limbs[limb] >> shift;
+
+    // The digit straddles into the next limb
+    if (shift + digit_bits > BigInt::LIMB_WIDTH && limb + 1 < n) {
+      digit |= limbs[limb + 1] << (BigInt::LIMB_WIDTH - shift);
+    }
+
+    digits[j] = digit & mask;
+  }
+
+  std::fill(digits + count, digits + padded_count, 0);
+}
+
+void VectorMontgomery::from_digits(const BigInt::limb_type *digits,
+                                   BigInt::limbs_size_type digit_count,
+                                   BigInt::bit_count_type digit_bits,
+                                   BigInt::bit_count_type shift,
+                                   BigInt::limbs_iter_type t,
+                                   BigInt::limbs_size_type count) {
+  BigInt::limb_type mask =
+      (static_cast<BigInt::limb_type>(1) << digit_bits) - 1;
+  BigInt::limb_type carry = 0;
+
+  // Bits waiting to be written out as limbs, lowest first
+  BigInt::double_limb_type pending = 0;
+  BigInt::bit_count_type pending_bits = 0;
+
+  for (BigInt::limbs_index_type p = 0, limb = 0; limb < count; ++p) {
+    BigInt::limb_type value = (p < digit_count ? digits[p] : 0) + carry;
+    BigInt::limb_type digit = value & mask;
+    BigInt::bit_count_type width = digit_bits;
+
+    carry = value >> digit_bits;
+
+    if (p == 0) {
+      digit >>= shift;
+      width -= shift;
+    }
+
+    pending |= static_cast<BigInt::double_limb_type>(digit) << pending_bits;
+    pending_bits += width;
+
+    if (pending_bits >= BigInt::LIMB_WIDTH) {
+      t[limb++] = static_cast<BigInt::limb_type>(pending);
+      pending >>= BigInt::LIMB_WIDTH;
+      pending_bits -= BigInt::LIMB_WIDTH;
+    }
+  }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2"))) void VectorMontgomery::accumulate_avx2(
+    BigInt::limb_type *acc, const BigInt::limb_type *lhs,
+    const BigInt::limb_type *rhs, const BigInt::limb_type *mod,
+    BigInt::limbs_size_type digit_count, BigInt::limbs_size_type padded_count,
+    BigInt::limbs_size_type full_steps, BigInt::bit_count_type last_bits,
+    BigInt::limb_type mod_neg_inv) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i mask = _mm256_set1_epi64x(
+      (static_cast<BigInt::limb_type>(1) << AVX2_DIGIT_BITS) - 1);
+
+  BigInt::limb_type *frame = acc + 1;
+  // The carry out of the digit last shifted out, which belongs to frame[0]
+  BigInt::limb_type carry = 0;
+
+  for (BigInt::limbs_index_type i = 0; i < digit_count; ++i) {
+    BigInt::bit_count_type bits = i < full_steps ? AVX2_DIGIT_BITS : last_bits;
+
+    // frame += lhs rhs_i + m mod, where m makes the low bits of frame[0] zero
+    BigInt::limb_type digit = frame[0] + carry + lhs[0] * rhs[i];
+    BigInt::limb_type m = (digit * mod_neg_inv) &
+                          ((static_cast<BigInt::limb_type>(1) << bits) - 1);
+
+    acc[0] = digit + m * mod[0];
+    carry = acc[0] >> AVX2_DIGIT_BITS;
+
+    __m256i rhs_digit = _mm256_set1_epi64x(rhs[i]);
+    __m256i m_digit = _mm256_set1_epi64x(m);
+
+    // Then divide by 2^AVX2_DIGIT_BITS, dropping frame[0]. Each chunk is
+    // stored a digit down, [low_1, low_2, low_3, next_low_0], once the next
+    // one is known.
+    __m256i low = zero;
+
+    for (BigInt::limbs_index_type c = 0; c < padded_count; c += AVX2_LANES) {
+      __m256i lhs_digits =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + c));
+      __m256i mod_digits =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mod + c));
+
+      __m256i next_low =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(frame + c));
+      next_low = _mm256_add_epi64(next_low,
+                                  _mm256_mul_epu32(lhs_digits, rhs_digit));
+      next_low =
+          _mm256_add_epi64(next_low, _mm256_mul_epu32(mod_digits, m_digit));
+
+      if (c > 0) {
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(frame + c - AVX2_LANES),
+            _mm256_alignr_epi8(
+                _mm256_permute2x128_si256(low, next_low, 0x21), low, 8));
+      }
+
+      low = next_low;
+    }
+
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i *>(frame + padded_count - AVX2_LANES),
+        _mm256_alignr_epi8(_mm256_permute2x128_si256(low, zero, 0x21), low,
+                           8));
+
+    // Move each digit's carry up into the next
+    if ((i + 1) % AVX2_NORMALISE_INTERVAL == 0) {
+      __m256i previous_high = zero;
+
+      for (BigInt::limbs_index_type c = 0; c < padded_count; c += AVX2_LANES) {
+        __m256i *digits = reinterpret_cast<__m256i *>(frame + c);
+        __m256i sum = _mm256_loadu_si256(digits);
+        __m256i high = _mm256_srli_epi64(sum, AVX2_DIGIT_BITS);
+
+        // [previous_high_3, high_0, high_1, high_2]
+        __m256i carries = _mm256_alignr_epi8(
+            high, _mm256_permute2x128_si256(previous_high, high, 0x21), 8);
+
+        _mm256_storeu_si256(
+            digits, _mm256_add_epi64(_mm256_and_si256(sum, mask), carries));
+        previous_high = high;
+      }
+    }
+  }
+}
+
+__attribute__((target("avx512f,avx512ifma"))) void
+VectorMontgomery::accumulate_ifma(
+    BigInt::limb_type *acc, const BigInt::limb_type *lhs,
+    const BigInt::limb_type *rhs, const BigInt::limb_type *mod,
+    BigInt::limbs_size_type digit_count, BigInt::limbs_size_type padded_count,
+    BigInt::limbs_size_type full_steps, BigInt::bit_count_type last_bits,
+    BigInt::limb_type mod_neg_inv) {
+  const __m512i zero = _mm512_setzero_si512();
+  const BigInt::limb_type mask =
+      (static_cast<BigInt::limb_type>(1) << IFMA_DIGIT_BITS) - 1;
+
+  BigInt::limb_type *frame = acc + 1;
+  // The carry out of the digit last shifted out, which belongs to frame[0]
+  BigInt::limb_type carry = 0;
+
+  for (BigInt::limbs_index_type i = 0; i < digit_count; ++i) {
+    BigInt::bit_count_type bits = i < full_steps ? IFMA_DIGIT_BITS : last_bits;
+
+    // frame += lhs rhs_i + m mod, where m makes the low bits of frame[0] zero
+    BigInt::limb_type digit = frame[0] + carry + ((lhs[0] * rhs[i]) & mask);
+    BigInt::limb_type m = (digit * mod_neg_inv) &
+                          ((static_cast<BigInt::limb_type>(1) << bits) - 1);
+
+    acc[0] = digit + ((m * mod[0]) & mask);
+    carry = acc[0] >> IFMA_DIGIT_BITS;
+
+    __m512i rhs_digit = _mm512_set1_epi64(rhs[i]);
+    __m512i m_digit = _mm512_set1_epi64(m);
+
+    // Then divide by 2^IFMA_DIGIT_BITS, dropping frame[0]. Each chunk of low
+    // halves is stored a digit down once the next one is known, but the high
+    // halves belong a digit up, so they stay where they are.
+    __m512i low = zero;
+    __m512i high = zero;
+
+    for (BigInt::limbs_index_type c = 0; c < padded_count; c += IFMA_LANES) {
+      __m512i lhs_digits = _mm512_loadu_si512(lhs + c);
+      __m512i mod_digits = _mm512_loadu_si512(mod + c);
+
+      __m512i next_low = _mm512_loadu_si512(frame + c);
+      next_low = _mm512_madd52lo_epu64(next_low, lhs_digits, rhs_digit);
+      next_low = _mm512_madd52lo_epu64(next_low, mod_digits, m_digit);
+
+      // The zero-masked form of valignq, as GCC's headers warn about the
+      // unmasked one
+      if (c > 0) {
+        _mm512_storeu_si512(
+            frame + c - IFMA_LANES,
+            _mm512_add_epi64(
+                _mm512_maskz_alignr_epi64(0xFF, next_low, low, 1), high));
+      }
+
+      low = next_low;
+      high = _mm512_madd52hi_epu64(zero, lhs_digits, rhs_digit);
+      high = _mm512_madd52hi_epu64(high, mod_digits, m_digit);
+    }
+
+    _mm512_storeu_si512(
+        frame + padded_count - IFMA_LANES,
+        _mm512_add_epi64(_mm512_maskz_alignr_epi64(0xFF, zero, low, 1), high));
+  }
+}
+#else
+void VectorMontgomery::accumulate_avx2(
+    BigInt::limb_type *, const BigInt::limb_type *, const BigInt::limb_type *,
+    const BigInt::limb_type *, BigInt::limbs_size_type,
+    BigInt::limbs_size_type, BigInt::limbs_size_type, BigInt::bit_count_type,
+    BigInt::limb_type) {
+  throw runtime_error("AVX2 is not available on this architecture");
+}
+
+void VectorMontgomery::accumulate_ifma(
+    BigInt::limb_type *, const BigInt::limb_type *, const BigInt::limb_type *,
+    const BigInt::limb_type *, BigInt::limbs_size_type,
+    BigInt::limbs_size_type, BigInt::limbs_size_type, BigInt::bit_count_type,
+    BigInt::limb_type) {
+  throw runtime_error("AVX-512 IFMA is not available on this architecture");
+}
+#endif
+
+BigInt::limbs_type
+VectorMontgomery::kernel_modulus(BigInt::limbs_const_iter_type mod,
+                                 BigInt::limbs_size_type n,
+                                 BigInt::bit_count_type digit_bits,
+                                 BigInt::limbs_size_type lanes) {
+  BigInt::limbs_size_type count = digits_in(n, digit_bits);
+  BigInt::limbs_size_type padded = padded_digits(count, lanes);
+
+  BigInt::limbs_type result(mod, mod + n);
+  result.resize(n + padded);
+
+  to_digits(mod, n, result.data() + n, count, padded, digit_bits);
+
+  return result;
+}
+
+BigInt::limbs_type
+VectorMontgomery::kernel_modulus_avx2(BigInt::limbs_const_iter_type mod,
+                                      BigInt::limbs_size_type n) {
+  return kernel_modulus(mod, n, AVX2_DIGIT_BITS, AVX2_LANES);
+}
+
+BigInt::limbs_type
+VectorMontgomery::kernel_modulus_ifma(BigInt::limbs_const_iter_type mod,
+                                      BigInt::limbs_size_type n) {
+  return kernel_modulus(mod, n, IFMA_DIGIT_BITS, IFMA_LANES);
+}
+
+void VectorMontgomery::multiply(BigInt::limbs_iter_type result,
+                                BigInt::limbs_const_iter_type lhs,
+                                BigInt::limbs_const_iter_type rhs,
+                                BigInt::limbs_const_iter_type mod,
+                                BigInt::limbs_size_type n,
+                                BigInt::limb_type mod_neg_inv,
+                                BigInt::bit_count_type digit_bits,
+                                BigInt::limbs_size_type lanes,
+                                accumulate_type accumulate) {
+  BigInt::limbs_size_type bits = n * BigInt::LIMB_WIDTH;
+
+  // Dividing by β^n takes full_steps steps of digit_bits bits, and one of
+  // last_bits unless digit_bits divides the width exactly
+  BigInt::limbs_size_type count = digits_in(n, digit_bits);
+  BigInt::limbs_size_type full_steps = bits / digit_bits;
+  BigInt::bit_count_type last_bits = bits - full_steps * digit_bits;
+
+  BigInt::limbs_size_type padded = padded_digits(count, lanes);
+
+  ScratchArena::Frame frame(ScratchArena::local());
+  BigInt::limbs_type &lhs_digits = frame.acquire(padded);
+  BigInt::limbs_type &rhs_digits = frame.acquire(padded);
+  BigInt::limbs_type &acc = frame.acquire(padded + 1);
+  BigInt::limbs_type &t = frame.acquire(n + 1);
+
+  to_digits(lhs, n, lhs_digits.data(), count, padded, digit_bits);
+  to_digits(rhs, n, rhs_digits.data(), count, padded, digit_bits);
+
+  std::fill(acc.begin(), acc.end(), 0);
+
+  // The digits of mod follow its limbs
+  accumulate(acc.data(), lhs_digits.data(), rhs_digits.data(), &mod[n], count,
+             padded, full_steps, last_bits, mod_neg_inv);
+
+  // acc[0] is divisible by 2^last_bits after a partial last step, or
+  // 2^digit_bits after a full one. The result is below 2 mod, so fits in
+  // n + 1 limbs.
+  from_digits(acc.data(), padded + 1, digit_bits,
+              last_bits == 0 ? digit_bits : last_bits, t.begin(), n + 1);
+
+  BigInt::subtract_if_not_less(result, t.cbegin(), mod, n);
+}
+
+void VectorMontgomery::multiply_avx2(BigInt::limbs_iter_type result,
+                                     BigInt::limbs_const_iter_type lhs,
+                                     BigInt::limbs_const_iter_type rhs,
+                                     BigInt::limbs_const_iter_type mod,
+                                     BigInt::limbs_size_type n,
+                                     BigInt::limb_type mod_neg_inv,
+                                     BigInt::limbs_iter_type) {
+  multiply(result, lhs, rhs, mod, n, mod_neg_inv, AVX2_DIGIT_BITS, AVX2_LANES,
+           &accumulate_avx2);
+}
+
+void VectorMontgomery::multiply_ifma(BigInt::limbs_iter_type result,
+                                     BigInt::limbs_const_iter_type lhs,
+                                     BigInt::limbs_const_iter_type rhs,
+                                     BigInt::limbs_const_iter_type mod,
+                                     BigInt::limbs_size_type n,
+                                     BigInt::limb_type mod_neg_inv,
+                                     BigInt::limbs_iter_type) {
+  multiply(result, lhs, rhs, mod, n, mod_neg_inv, IFMA_DIGIT_BITS, IFMA_LANES,
+           &accumulate_ifma);
+}
+
+void VectorMontgomery::square_avx2(BigInt::limbs_iter_type result,
+                                   BigInt::limbs_const_iter_type value,
+                                   BigInt::limbs_const_iter_type mod,
+                                   BigInt::limbs_size_type n,
+                                   BigInt::limb_type mod_neg_inv,
+                                   BigInt::limbs_type &) {
+  multiply(result, value, value, mod, n, mod_neg_inv, AVX2_DIGIT_BITS,
+           AVX2_LANES, &accumulate_avx2);
+}
+
+void VectorMontgomery::square_ifma(BigInt::limbs_iter_type result,
+                                   BigInt::limbs_const_iter_type value,
+                                   BigInt::limbs_const_iter_type mod,
+                                   BigInt::limbs_size_type n,
+                                   BigInt::limb_type mod_neg_inv,
+                                   BigInt::limbs_type &) {
+  multiply(result, value, value, mod, n, mod_neg_inv, IFMA_DIGIT_BITS,
+           IFMA_LANES, &accumulate_ifma);
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "bigint.hpp"
+#include "scratcharena.hpp"
+
+using std::runtime_error;
+
+// Montgomery multiplication on the CPU's vector units. Operands are split
+// into digits narrower than a limb, so a whole vector of partial products can
+// be accumulated without propagating carries: 29-bit digits multiplied four
+// at a time with AVX2, or 52-bit digits eight at a time with AVX-512 IFMA.
+// The kernels take the same arguments as BigInt's fixed-length ones, except
+// that the modulus must be in the form kernel_modulus_avx2 or
+// kernel_modulus_ifma gives, so that it's split into digits only once. They
+// give the same results, and never branch on or index memory by the values of
+// their operands. Each may only be called when the CPU supports it.
+class VectorMontgomery {
+public:
+  // The largest modulus the kernels accept, in limbs
+  static const BigInt::limbs_size_type MAX_LIMBS = 64;
+
+  // Moduli of at least this many limbs use the kernels when the CPU supports
+  // them, see bench/vector.cpp
+  static const BigInt::limbs_size_type AVX2_MIN_LIMBS = 32;
+  static const BigInt::limbs_size_type IFMA_MIN_LIMBS = 16;
+
+  static const BigInt::bit_count_type AVX2_DIGIT_BITS = 29;
+  static const BigInt::bit_count_type IFMA_DIGIT_BITS = 52;
+
+private:
+  static const BigInt::limbs_size_type AVX2_LANES = 4;
+  static const BigInt::limbs_size_type IFMA_LANES = 8;
+
+  // The AVX2 accumulators grow by less than 2^59 a step, so their carries
+  // are moved up a digit this often to keep them below 2^64
+  static const BigInt::limbs_size_type AVX2_NORMALISE_INTERVAL = 8;
+
+  // The number of digits of digit_bits bits in n limbs, and the number the
+  // kernels pad them to, with room for the accumulator, which stays below
+  // 2 mod, to carry into the top digit and one more
+  static BigInt::limbs_size_type digits_in(BigInt::limbs_size_type n,
+                                           BigInt::bit_count_type digit_bits);
+  static BigInt::limbs_size_type
+  padded_digits(BigInt::limbs_size_type digit_count,
+                BigInt::limbs_size_type lanes);
+
+  // Split the n limbs into count digits of digit_bits bits, least significant
+  // first, zero filling up to padded_count
+  static void to_digits(BigInt::limbs_const_iter_type limbs,
+                        BigInt::limbs_size_type n, BigInt::limb_type *digits,
+                        BigInt::limbs_size_type count,
+                        BigInt::limbs_size_type padded_count,
+                        BigInt::bit_count_type digit_bits);
+
+  // t = (Σ digits_p 2^(digit_bits p)) >> shift, as exactly count limbs. The
+  // digits may be wider than digit_bits, and the bits shifted out must be
+  // zero.
+  static void from_digits(const BigInt::limb_type *digits,
+                          BigInt::limbs_size_type digit_count,
+                          BigInt::bit_count_type digit_bits,
+                          BigInt::bit_count_type shift,
+                          BigInt::limbs_iter_type t,
+                          BigInt::limbs_size_type count);
+
+  // Montgomery reduction steps over digit_count digits of lhs and rhs, each
+  // padded with zeros to padded_count digits. The first full_steps divide by
+  // 2^digit_bits and any remaining step by 2^last_bits. The accumulator is
+  // kept from acc + 1, shifted down a digit by each step, and the last digit
+  // shifted out is left in acc[0].
+  typedef void (*accumulate_type)(BigInt::limb_type *acc,
+                                  const BigInt::limb_type *lhs,
+                                  const BigInt::limb_type *rhs,
+                                  const BigInt::limb_type *mod,
+                                  BigInt::limbs_size_type digit_count,
+                                  BigInt::limbs_size_type padded_count,
+                                  BigInt::limbs_size_type full_steps,
+                                  BigInt::bit_count_type last_bits,
+                                  BigInt::limb_type mod_neg_inv);
+
+  static void accumulate_avx2(BigInt::limb_type *acc,
+                              const BigInt::limb_type *lhs,
+                              const BigInt::limb_type *rhs,
+                              const BigInt::limb_type *mod,
+                              BigInt::limbs_size_type digit_count,
+                              BigInt::limbs_size_type padded_count,
+                              BigInt::limbs_size_type full_steps,
+                              BigInt::bit_count_type last_bits,
+                              BigInt::limb_type mod_neg_inv);
+  static void accumulate_ifma(BigInt::limb_type *acc,
+                              const BigInt::limb_type *lhs,
+                              const BigInt::limb_type *rhs,
+                              const BigInt::limb_type *mod,
+                              BigInt::limbs_size_type digit_count,
+                              BigInt::limbs_size_type padded_count,
+                              BigInt::limbs_size_type full_steps,
+                              BigInt::bit_count_type last_bits,
+                              BigInt::limb_type mod_neg_inv);
+
+  static BigInt::limbs_type kernel_modulus(BigInt::limbs_const_iter_type mod,
+                                           BigInt::limbs_size_type n,
+                                           BigInt::bit_count_type digit_bits,
+                                           BigInt::limbs_size_type lanes);
+
+  // result = lhs * rhs / β^n mod mod, through accumulate
+  static void multiply(BigInt::limbs_iter_type result,
+                       BigInt::limbs_const_iter_type lhs,
+                       BigInt::limbs_const_iter_type rhs,
+                       BigInt::limbs_const_iter_type mod,
+                       BigInt::limbs_size_type n,
+                       BigInt::limb_type mod_neg_inv,
+                       BigInt::bit_count_type digit_bits,
+                       BigInt::limbs_size_type lanes,
+                       accumulate_type accumulate);
+
+public:
+  static bool avx2_supported();
+  static bool ifma_supported();
+
+  // The n limbs of mod followed by its digits, which is the modulus the
+  // kernels of the same backend take
+  static BigInt::limbs_type
+  kernel_modulus_avx2(BigInt::limbs_const_iter_type mod,
+                      BigInt::limbs_size_type n);
+  static BigInt::limbs_type
+  kernel_modulus_ifma(BigInt::limbs_const_iter_type mod,
+                      BigInt::limbs_size_type n);
+
+  // result = lhs * rhs / β^n mod mod, where n <= MAX_LIMBS. result may alias
+  // lhs or rhs, and t is unused.
+  static void multiply_avx2(BigInt::limbs_iter_type result,
+                            BigInt::limbs_const_iter_type lhs,
+                            BigInt::limbs_const_iter_type rhs,
+                            BigInt::limbs_const_iter_type mod,
+                            BigInt::limbs_size_type n,
+                            BigInt::limb_type mod_neg_inv,
+                            BigInt::limbs_iter_type t);
+  static void multiply_ifma(BigInt::limbs_iter_type result,
+                            BigInt::limbs_const_iter_type lhs,
+                            BigInt::limbs_const_iter_type rhs,
+                            BigInt::limbs_const_iter_type mod,
+                            BigInt::limbs_size_type n,
+                            BigInt::limb_type mod_neg_inv,
+                            BigInt::limbs_iter_type t);
+
+  // result = value^2 / β^n mod mod, where n <= MAX_LIMBS. t is unused.
+  static void square_avx2(BigInt::limbs_iter_type result,
+                          BigInt::limbs_const_iter_type value,
+                          BigInt::limbs_const_iter_type mod,
+                          BigInt::limbs_size_type n,
+                          BigInt::limb_type mod_neg_inv,
+                          BigInt::limbs_type &t);
+  static void square_ifma(BigInt::limbs_iter_type result,
+                          BigInt::limbs_const_iter_type value,
+                          BigInt::limbs_const_iter_type mod,
+                          BigInt::limbs_size_type n,
+                          BigInt::limb_type mod_neg_inv,
+                          BigInt::limbs_type &t);
+};
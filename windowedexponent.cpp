@@ -0,0 +1,78 @@
+#include "windowedexponent.hpp"
+
+WindowedExponent::WindowedExponent() : width(1), final_squarings(0) {}
+
+WindowedExponent::WindowedExponent(const BigInt &n) { assign(n); }
+
+// https://wikimedia.org/api/rest_v1/media/math/render/svg/1e865f7688532c911e9c0f65df83d8d3976b2ecc
+bool WindowedExponent::width_check(BigInt::bit_index_type log_n,
+                                   BigInt::bit_index_type k) {
+  return log_n <
+         ((k * (k + 1) * (1 << (2 * k))) / ((1 << (k + 1)) - k - 2) + 1);
+}
+
+// https://en.wikipedia.org/wiki/Exponentiation_by_squaring#Sliding_window_method
+void WindowedExponent::assign(const BigInt &n) {
+  BigInt::bit_index_type log_n = n.log_2();
+
+  BigInt::bit_index_type k = 1;
+
+  while (!width_check(log_n, k)) {
+    ++k;
+  }
+
+  width = k;
+  windows.clear();
+
+  // Squarings owed since the last window, one for every bit passed
+  BigInt::bit_index_type squarings = 0;
+
+  for (BigInt::bit_index_type i = log_n - 1; i >= 0;) {
+    BigInt::bit_index_type s =
+        std::max(i - k + 1, static_cast<BigInt::bit_index_type>(0));
+    BigInt::bit_count_type window_width = i - s + 1;
+
+    BigInt::limb_type u = n.window(s, window_width);
+
+    // Skip the zero bits above the window's highest set bit
+    BigInt::bit_count_type zeros =
+        u == 0 ? window_width
+               : __builtin_clzll(u) - (BigInt::LIMB_WIDTH - window_width);
+
+    if (zeros > 0) {
+      squarings += zeros;
+      i -= zeros;
+      continue;
+    }
+
+    // Shrink the window down to its lowest set bit, making u odd
+    BigInt::bit_count_type trailing_zeros = __builtin_ctzll(u);
+    s += trailing_zeros;
+    u >>= trailing_zeros;
+
+    squarings += i - s + 1;
+
+    // The top bit is set, so the first window starts the result off and
+    // never squares 1
+    windows.push_back(Window{windows.empty() ? 0 : squarings, u / 2});
+    squarings = 0;
+
+    i = s - 1;
+  }
+
+  final_squarings = squarings;
+}
+
+BigInt::bit_count_type WindowedExponent::max_width() const { return width; }
+
+WindowedExponent::window_iter_type WindowedExponent::begin() const {
+  return windows.cbegin();
+}
+
+WindowedExponent::window_iter_type WindowedExponent::end() const {
+  return windows.cend();
+}
+
+BigInt::bit_index_type WindowedExponent::squarings_after() const {
+  return final_squarings;
+}
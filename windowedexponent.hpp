@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "bigint.hpp"
+
+// An exponent split into the windows of sliding window exponentiation, so
+// that an exponent raised to many times, like a private key, is only scanned
+// once. x^n is x^(first window), then for each later window some squarings
+// and a multiplication by an odd power of x, then some final squarings.
+class WindowedExponent {
+public:
+  struct Window {
+    BigInt::bit_index_type squarings;
+    // The window's value, which is odd, is 2 odd_power + 1
+    BigInt::limb_type odd_power;
+  };
+
+  typedef std::vector<Window>::const_iterator window_iter_type;
+
+private:
+  BigInt::bit_count_type width;
+  std::vector<Window> windows;
+  BigInt::bit_index_type final_squarings;
+
+  static bool width_check(BigInt::bit_index_type log_n,
+                          BigInt::bit_index_type k);
+
+public:
+  // The exponent 0
+  WindowedExponent();
+  WindowedExponent(const BigInt &n);
+
+  // Rescan for n, reusing the existing storage
+  void assign(const BigInt &n);
+
+  // The largest window width, which needs 2^(width - 1) odd powers
+  BigInt::bit_count_type max_width() const;
+
+  // No windows for an exponent of 0
+  window_iter_type begin() const;
+  window_iter_type end() const;
+
+  BigInt::bit_index_type squarings_after() const;
+};